@@ -0,0 +1,168 @@
+//----------------------------------------------------------------------
+// alloc_stats.cpp
+//
+// Global allocation hooks for CMD_ALLOC_STATS builds.
+//
+// With the GNU C++ runtime a thrown object is allocated by
+// __cxa_allocate_exception() with malloc(), not operator new, so we
+// interpose that function too and forward to the real one found with
+// dlsym(RTLD_NEXT). This needs the runtime to be linked dynamically,
+// and -ldl on glibc older than 2.34. The MSVC runtime builds thrown
+// objects on the stack, so there is nothing to hook there.
+//----------------------------------------------------------------------
+#ifdef CMD_ALLOC_STATS
+
+#include "alloc_stats.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <dlfcn.h>
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+struct SiteCounters {
+    std::atomic<uint64_t> allocs{ 0 };
+    std::atomic<uint64_t> bytes{ 0 };
+};
+
+const char* const SITE_NAMES[ALLOC_SITE_COUNT] = {
+    "other", "getline", "processInput", "validateCommand", "exception"
+};
+
+SiteCounters sites[ALLOC_SITE_COUNT];
+std::atomic<uint64_t> frees{ 0 };
+std::atomic<uint64_t> commands{ 0 };
+
+thread_local AllocSite currentSite = ALLOC_OTHER;
+
+void charge(AllocSite site, size_t size) {
+    sites[site].allocs.fetch_add(1, std::memory_order_relaxed);
+    sites[site].bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------
+// - peak resident set size in KB, 0 if unknown
+//----------------------------------------------------------------------
+uint64_t peakRssKb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof pmc)) {
+        return pmc.PeakWorkingSetSize / 1024;
+    }
+    return 0;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;      // bytes on macOS
+#else
+    return usage.ru_maxrss;             // KB on Linux
+#endif
+#endif
+}
+
+//----------------------------------------------------------------------
+// - prints the totals and per-command figures, registered with atexit
+//----------------------------------------------------------------------
+void report() {
+    uint64_t n = commands.load();
+    double per = n ? 1.0 / n : 0.0;
+
+    fprintf(stderr, "\nallocation report: %llu commands\n",
+        static_cast<unsigned long long>(n));
+    fprintf(stderr, "  %-16s %12s %14s %12s %12s\n",
+        "site", "allocs", "bytes", "allocs/cmd", "bytes/cmd");
+
+    for (int i = 0; i < ALLOC_SITE_COUNT; ++i) {
+        uint64_t a = sites[i].allocs.load();
+        uint64_t b = sites[i].bytes.load();
+        fprintf(stderr, "  %-16s %12llu %14llu %12.3f %12.1f\n",
+            SITE_NAMES[i], static_cast<unsigned long long>(a),
+            static_cast<unsigned long long>(b), a * per, b * per);
+    }
+
+    fprintf(stderr, "  frees %llu, peak RSS %llu KB\n",
+        static_cast<unsigned long long>(frees.load()),
+        static_cast<unsigned long long>(peakRssKb()));
+}
+
+// registers the report before main() runs
+struct ReportAtExit {
+    ReportAtExit() { atexit(report); }
+} reportAtExit;
+
+void* allocate(size_t size) {
+    charge(currentSite, size);
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void release(void* p) {
+    if (p) {
+        frees.fetch_add(1, std::memory_order_relaxed);
+        free(p);
+    }
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// AllocScope
+//------------------------------------------------------------------------------
+AllocScope::AllocScope(AllocSite site) : previous(currentSite) {
+    currentSite = site;
+}
+
+AllocScope::~AllocScope() {
+    currentSite = previous;
+}
+
+void allocCountCommands(size_t n) {
+    commands.fetch_add(n, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+// replaced global allocation functions
+//------------------------------------------------------------------------------
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+void operator delete[](void* p, size_t) noexcept { release(p); }
+
+#ifndef _WIN32
+//------------------------------------------------------------------------------
+// - charges every thrown object to the exception site, then calls the
+//   runtime's own allocator
+//------------------------------------------------------------------------------
+extern "C" void* __cxa_allocate_exception(size_t size) noexcept {
+    using AllocateFn = void* (*)(size_t);
+    static AllocateFn real = reinterpret_cast<AllocateFn>(
+        dlsym(RTLD_NEXT, "__cxa_allocate_exception"));
+
+    if (!real) {
+        abort();
+    }
+
+    charge(ALLOC_EXCEPTION, size);
+    return real(size);
+}
+#endif
+
+#endif // CMD_ALLOC_STATS
@@ -0,0 +1,58 @@
+//----------------------------------------------------------------------
+// alloc_stats.h
+//
+// Allocation accounting for instrumentation builds.
+//
+// Build with CMD_ALLOC_STATS defined to replace the global operator
+// new/delete and hook __cxa_allocate_exception. Every allocation is
+// charged to the site that is active on its thread, and a report of
+// allocations and bytes per validated command, plus peak RSS, is
+// printed to stderr at exit.
+//
+// Without CMD_ALLOC_STATS the macros below compile to nothing.
+//----------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+
+//----------------------------------------------------------------------
+// places allocations are charged to
+//----------------------------------------------------------------------
+enum AllocSite {
+    ALLOC_OTHER,
+    ALLOC_GETLINE,              // input string growth in getline()
+    ALLOC_PROCESS_INPUT,        // lowercase copy in processInput()
+    ALLOC_VALIDATE_COMMAND,     // rest of validateCommand()
+    ALLOC_EXCEPTION,            // thrown exception objects
+    ALLOC_SITE_COUNT
+};
+
+#ifdef CMD_ALLOC_STATS
+
+//----------------------------------------------------------------------
+// AllocScope : charges this thread's allocations to a site while alive
+//----------------------------------------------------------------------
+class AllocScope {
+public:
+    explicit AllocScope(AllocSite site);
+    ~AllocScope();
+
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+
+private:
+    AllocSite previous;
+};
+
+// counts commands, the denominator of the per-command figures
+void allocCountCommands(size_t n);
+
+#define ALLOC_SCOPE(site) AllocScope allocScope_(site)
+#define ALLOC_COUNT_COMMANDS(n) allocCountCommands(n)
+
+#else
+
+#define ALLOC_SCOPE(site) ((void)0)
+#define ALLOC_COUNT_COMMANDS(n) ((void)0)
+
+#endif
@@ -0,0 +1,388 @@
+//----------------------------------------------------------------------
+// bench.cpp
+//
+// Measures the validator on each file of a versioned corpus and
+// compares the results with stored baselines.
+//
+// Two paths are measured per corpus file:
+//
+//     interactive   validateString()/validateCommand() with their
+//                   exceptions, through handleCommandLine()
+//     engine        classifyLine() with the selected engine
+//
+// For each path we keep the best throughput over several runs, and
+// for the interactive path the lowest per-run p99 time per line. A
+// result fails when throughput drops, or p99 rises, by more than the
+// threshold.
+//
+// Baselines depend on the machine, so record them with
+// --update-baseline on the machine that runs the comparison.
+//----------------------------------------------------------------------
+#include "bench.h"
+#include "cmd_validate.h"
+#include "engines.h"
+#include "handler_registry.h"
+#include "harness.h"
+#include "line_index.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::cerr;
+using std::cout;
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// corpus files, in report order
+const char* const CORPUS_FILES[] = {
+    "realistic.txt", "junk_flood.txt", "long_valid.txt", "adversarial.txt"
+};
+
+using Clock = std::chrono::steady_clock;
+
+uint64_t elapsedNs(Clock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - since).count();
+}
+
+bool readFile(const string& path, string& data) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    data = ss.str();
+    return true;
+}
+
+// - splits the corpus into lines once, outside the timed loops
+vector<string> splitLines(const string& data) {
+    vector<string> lines;
+    LineIndex index;
+    size_t start = 0;
+    for (size_t window = 0; window < data.size(); window += INDEX_WINDOW) {
+        size_t len = data.size() - window;
+        index.build(data.data() + window,
+            len < INDEX_WINDOW ? len : INDEX_WINDOW);
+        for (uint32_t offset : index) {
+            size_t nl = window + offset;
+            lines.push_back(data.substr(start, nl - start));
+            start = nl + 1;
+        }
+    }
+    if (start < data.size()) {
+        lines.push_back(data.substr(start));
+    }
+    return lines;
+}
+
+//----------------------------------------------------------------------
+// - best lines/s and lowest per-run p99 ns per line over the runs;
+//   taking the best run keeps scheduler noise out of the comparison
+//----------------------------------------------------------------------
+void benchInteractive(vector<string>& lines, int runs, double& bestLps,
+    double& p99Ns) {
+
+    NullBuffer null;
+    std::streambuf* saved = cout.rdbuf(&null);
+
+    vector<uint64_t> perLine;
+    perLine.reserve(lines.size());
+    bestLps = 0;
+    p99Ns = 0;
+
+    // run -1 warms up caches and branch predictors and is not counted
+    for (int r = -1; r < runs; ++r) {
+        perLine.clear();
+        Clock::time_point start = Clock::now();
+        for (string& line : lines) {
+            Clock::time_point lineStart = Clock::now();
+            handleCommandLine(line);
+            perLine.push_back(elapsedNs(lineStart));
+        }
+        double lps = lines.size() * 1e9 / elapsedNs(start);
+        double p99 = static_cast<double>(percentile(perLine, 0.99));
+
+        if (r >= 0) {
+            bestLps = std::max(bestLps, lps);
+            p99Ns = r == 0 ? p99 : std::min(p99Ns, p99);
+        }
+    }
+
+    cout.rdbuf(saved);
+}
+
+double benchEngine(const vector<string>& lines, int runs) {
+    // enough passes over the file for a stable clock reading
+    const size_t passes = 1 + 2000000 / (lines.size() + 1);
+    double bestLps = 0;
+    size_t sink = 0;
+
+    for (int r = 0; r < runs; ++r) {
+        Clock::time_point start = Clock::now();
+        for (size_t p = 0; p < passes; ++p) {
+            for (const string& line : lines) {
+                sink += classifyLine(line.data(), line.size());
+            }
+        }
+        double lps = lines.size() * passes * 1e9 / elapsedNs(start);
+        bestLps = std::max(bestLps, lps);
+    }
+
+    // keeps the loop from being optimized away
+    if (sink == 1) {
+        cerr << "";
+    }
+    return bestLps;
+}
+
+//----------------------------------------------------------------------
+// - baseline files hold "<corpus> <metric> <value>" lines, and
+//   comments starting with '#'
+//----------------------------------------------------------------------
+map<string, double> loadBaseline(const char* path) {
+    map<string, double> values;
+    std::ifstream in(path);
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        string corpus, metric;
+        double value;
+        if (fields >> corpus >> metric >> value) {
+            values[corpus + ' ' + metric] = value;
+        }
+    }
+    return values;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// - entry point for --bench
+//------------------------------------------------------------------------------
+int benchMain(int argc, char* argv[]) {
+    const char* dir = nullptr;
+    const char* baselinePath = nullptr;
+    double threshold = 10;
+    bool update = false;
+    int runs = 15;
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--baseline") && hasValue) {
+            baselinePath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--threshold") && hasValue) {
+            threshold = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--runs") && hasValue) {
+            runs = std::max(1, atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "--update-baseline")) {
+            update = true;
+        }
+        else if (!dir && argv[i][0] != '-') {
+            dir = argv[i];
+        }
+        else {
+            dir = nullptr;
+            break;
+        }
+    }
+    if (!dir || (update && !baselinePath)) {
+        cerr << "Usage: --bench <corpus-dir> [--baseline <file>]"
+            " [--threshold <percent>] [--update-baseline] [--runs <n>]\n";
+        return 2;
+    }
+
+    map<string, double> baseline;
+    if (baselinePath && !update) {
+        baseline = loadBaseline(baselinePath);
+    }
+
+    std::ostringstream results;
+    results << std::fixed;
+    results.precision(0);
+    results << "# corpus metric value, engine " << engineName() << '\n';
+
+    int failures = 0;
+    auto check = [&](const string& corpus, const char* metric, double value,
+        bool higherIsBetter) {
+
+        results << corpus << ' ' << metric << ' ' << value << '\n';
+
+        char line[160];
+        auto it = baseline.find(corpus + ' ' + metric);
+        if (it == baseline.end()) {
+            snprintf(line, sizeof line, "  %-18s %-16s %14.0f\n",
+                corpus.c_str(), metric, value);
+            cout << line;
+            return;
+        }
+
+        double change = (value - it->second) / it->second * 100;
+        double worse = higherIsBetter ? -change : change;
+        bool failed = worse > threshold;
+        failures += failed;
+
+        snprintf(line, sizeof line, "  %-18s %-16s %14.0f %+8.1f%%%s\n",
+            corpus.c_str(), metric, value, change, failed ? "  FAIL" : "");
+        cout << line;
+    };
+
+    for (const char* name : CORPUS_FILES) {
+        string data;
+        if (!readFile(string(dir) + "/" + name, data)) {
+            cerr << "Cannot read corpus file " << dir << '/' << name << '\n';
+            return 1;
+        }
+        vector<string> lines = splitLines(data);
+
+        double interactiveLps, p99Ns;
+        benchInteractive(lines, runs, interactiveLps, p99Ns);
+        double engineLps = benchEngine(lines, runs);
+
+        string corpus(name, strchr(name, '.') - name);
+        check(corpus, "interactive_lps", interactiveLps, true);
+        check(corpus, "interactive_p99", p99Ns, false);
+        check(corpus, "engine_lps", engineLps, true);
+    }
+
+    if (update) {
+        std::ofstream out(baselinePath);
+        out << results.str();
+        if (!out) {
+            cerr << "Cannot write baseline " << baselinePath << '\n';
+            return 1;
+        }
+        cout << "baseline written to " << baselinePath << '\n';
+    }
+
+    if (failures) {
+        cout << failures << " result(s) more than " << threshold
+            << "% worse than baseline\n";
+        return 1;
+    }
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// - entry point for --bench-dispatch
+//------------------------------------------------------------------------------
+int benchDispatchMain(int argc, char* argv[]) {
+    size_t ops = 20000000;
+    if (argc == 2 && !strcmp(argv[0], "--ops")) {
+        ops = strtoull(argv[1], nullptr, 10);
+    }
+    else if (argc != 0) {
+        cerr << "Usage: --bench-dispatch [--ops <n>]\n";
+        return 2;
+    }
+
+    // a fixed pseudo-random opcode stream, quit left out
+    vector<Command> cmds(1 << 16);
+    uint32_t x = 12345;
+    for (Command& c : cmds) {
+        x = x * 1664525 + 1013904223;
+        c = static_cast<Command>((x >> 16) % CMD_QUIT);
+    }
+    const size_t mask = cmds.size() - 1;
+
+    uint64_t counts[3][HandlerRegistry::SLOTS] = {};
+    char line[] = "play";
+    double ns[3];
+
+    // flat registry, lambdas stored in the slots
+    {
+        HandlerRegistry registry;
+        uint64_t* c = counts[0];
+        for (int cmd = 0; cmd < CMD_NUM_COMMANDS; ++cmd) {
+            registry.set(static_cast<Command>(cmd),
+                [c](Command k, const char*, size_t) { ++c[k]; });
+        }
+
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < ops; ++i) {
+            registry.dispatch(cmds[i & mask], line, 4);
+        }
+        ns[0] = static_cast<double>(elapsedNs(start)) / ops;
+    }
+
+    // std::function table
+    {
+        std::function<void(Command, const char*, size_t)>
+            table[HandlerRegistry::SLOTS];
+        uint64_t* c = counts[1];
+        for (int cmd = 0; cmd < CMD_NUM_COMMANDS; ++cmd) {
+            table[cmd] = [c](Command k, const char*, size_t) { ++c[k]; };
+        }
+
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < ops; ++i) {
+            Command cmd = cmds[i & mask];
+            table[cmd](cmd, line, 4);
+        }
+        ns[1] = static_cast<double>(elapsedNs(start)) / ops;
+    }
+
+    // print the response, then parse it back as a consumer of stdout
+    // has to
+    {
+        uint64_t* c = counts[2];
+        string out;
+        out.reserve(64);
+
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < ops; ++i) {
+            out.clear();
+            out += commandName(cmds[i & mask]);
+            out += "\n\n";
+
+            size_t end = out.find('\n');
+            for (int cmd = 0; cmd < CMD_NUM_COMMANDS; ++cmd) {
+                if (!out.compare(0, end, commandName(static_cast<Command>(cmd)))) {
+                    ++c[cmd];
+                    break;
+                }
+            }
+        }
+        ns[2] = static_cast<double>(elapsedNs(start)) / ops;
+    }
+
+    bool same = !memcmp(counts[0], counts[1], sizeof counts[0])
+        && !memcmp(counts[0], counts[2], sizeof counts[0]);
+
+    char text[160];
+    snprintf(text, sizeof text, "%zu dispatches\n"
+        "  registry         %8.2f ns/op\n"
+        "  std::function    %8.2f ns/op\n"
+        "  print and parse  %8.2f ns/op\n",
+        ops, ns[0], ns[1], ns[2]);
+    cout << text;
+
+    if (!same) {
+        cerr << "dispatch variants disagree\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,21 @@
+//----------------------------------------------------------------------
+// bench.h
+//
+// Regression benchmark over the fixed corpus in bench/corpus.
+//----------------------------------------------------------------------
+#pragma once
+
+//----------------------------------------------------------------------
+// - entry point for --bench <corpus-dir> [--baseline <file>]
+//   [--threshold <percent>] [--update-baseline] [--runs <n>]
+// - returns 1 if any result is more than threshold percent worse
+//   than its baseline
+//----------------------------------------------------------------------
+int benchMain(int argc, char* argv[]);
+
+//----------------------------------------------------------------------
+// - entry point for --bench-dispatch [--ops <n>]
+// - compares handler dispatch through HandlerRegistry, a table of
+//   std::function and printing the response then parsing it back
+//----------------------------------------------------------------------
+int benchDispatchMain(int argc, char* argv[]);
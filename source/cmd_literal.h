@@ -0,0 +1,108 @@
+//----------------------------------------------------------------------
+// cmd_literal.h
+//
+// Compile-time command literals for code that issues fixed commands:
+//
+//     using namespace cmd_literals;
+//     constexpr Command cmd = "play"_cmd;        // CMD_PLAY
+//
+// A literal must be a command name or a menu letter, in any case, and
+// must mean at runtime what it says: the opcode is a constant, so it
+// costs nothing while running. Anything else does not compile, and the
+// error names the rule that failed:
+//
+//     "plya"_cmd      not a command name or menu letter
+//     "pause"_cmd     the runtime first-letter rule makes the line
+//                     "pause" a play command, so write "A"_cmd
+//
+// Needs C++20 (consteval).
+//----------------------------------------------------------------------
+#pragma once
+
+#include "cmd_validate.h"
+
+#include <cstddef>
+
+#ifdef __cpp_consteval
+
+namespace cmd_literals {
+
+namespace detail {
+
+constexpr char lower(char c) {
+    return c >= 'A' && c <= 'Z' ? c + 0x20 : c;
+}
+
+// - true if [str, str + len) is `name`, ignoring case
+constexpr bool sameName(const char* str, size_t len, const char* name) {
+    size_t i = 0;
+    for (; i < len && name[i]; ++i) {
+        if (lower(str[i]) != name[i]) {
+            return false;
+        }
+    }
+    return i == len && !name[i];
+}
+
+// - the opcode the runtime if-chain picks from the first letter
+constexpr Command runtimeRoute(char first) {
+    switch (lower(first)) {
+    case 'p': return CMD_PLAY;
+    case 'a': return CMD_PAUSE;
+    case 'r': return CMD_REWIND;
+    case 'f': return CMD_FAST_FORWARD;
+    case 's': return CMD_STOP;
+    case 'q': return CMD_QUIT;
+    }
+    return CMD_UNRECOGNIZED;
+}
+
+// command names and menu letters, lowercase
+struct Spelling {
+    const char* name;
+    const char* letter;
+    Command cmd;
+};
+
+constexpr Spelling SPELLINGS[] = {
+    { "play", "p", CMD_PLAY },
+    { "pause", "a", CMD_PAUSE },
+    { "rewind", "r", CMD_REWIND },
+    { "fast-forward", "f", CMD_FAST_FORWARD },
+    { "stop", "s", CMD_STOP },
+    { "quit", "q", CMD_QUIT },
+};
+
+// not constexpr: reaching one of these during constant evaluation
+// stops compilation, and the compiler names it in the error
+inline void empty_command_literal() {}
+inline void not_a_command_name_or_menu_letter() {}
+inline void runtime_reads_this_literal_as_another_command() {}
+
+} // namespace detail
+
+//----------------------------------------------------------------------
+// - "<command>"_cmd: the opcode of a command name or menu letter
+//----------------------------------------------------------------------
+consteval Command operator""_cmd(const char* str, size_t len) {
+    if (len == 0) {
+        detail::empty_command_literal();
+    }
+
+    for (const detail::Spelling& s : detail::SPELLINGS) {
+        if (detail::sameName(str, len, s.name)
+            || detail::sameName(str, len, s.letter)) {
+            if (detail::runtimeRoute(str[0]) != s.cmd) {
+                detail::runtime_reads_this_literal_as_another_command();
+            }
+            return s.cmd;
+        }
+    }
+
+    detail::not_a_command_name_or_menu_letter();
+    return CMD_UNRECOGNIZED;
+}
+
+} // namespace cmd_literals
+
+#endif
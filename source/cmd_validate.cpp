@@ -15,6 +15,29 @@
 // for error handling. Exceptions are slow, and they disrupt
 // the call stack.
 //----------------------------------------------------------------------
+#include "cmd_validate.h"
+#include "alloc_stats.h"
+#include "bench.h"
+#include "cmd_literal.h"
+#include "engines.h"
+#include "handler_registry.h"
+#include "harness.h"
+#include "lean_io.h"
+#include "line_filter.h"
+#include "line_reader.h"
+#include "localized.h"
+#include "normalize.h"
+#include "player_sim.h"
+#include "loadgen.h"
+#include "rate_window.h"
+#include "replay.h"
+#include "server.h"
+#include "sketches.h"
+#include "trace.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <iostream>
 #include <string>
@@ -25,64 +48,217 @@
 using std::cin;
 using std::cout;
 using std::exception;
-using std::getline;
 using std::string;
 
-// local function prototypes
-string processInput(string& userInput);
-bool validateString(string& passed);
-
-// this function throws InvalidCommandException exception
-void validateCommand(string& command);
+// where to save the rejected-input sketches at exit, if anywhere
+static const char* sketchOutPath = nullptr;
 
-// exits app
-int quitFunction();
-
-//----------------------------------------------------------------------
-// InvalidCommandException : thrown on bad command input
-//----------------------------------------------------------------------
-class InvalidCommandException : public std::exception {
-public:
-    const char* what() {
-        return "Unrecognized command exception: ";
-    }
-};
+// - saves the rejected-input sketches if --sketch-out was given
+// - reports the engine cross-check if it was on
+// - returns the exit code to use
+static int finishRun(int result);
 
 //------------------------------------------------------------------------------
 // entry point
 //------------------------------------------------------------------------------
-int main() {
+int main(int argc, char* argv[]) {
+
+    // options that apply to every mode come first
+    int arg = 1;
+    while (arg < argc) {
+        // trim and collapse blanks before validation, see normalize.h
+        if (!strcmp(argv[arg], "--normalize")) {
+            setNormalize(true);
+            ++arg;
+            continue;
+        }
+
+        // the rest take a value
+        if (arg + 1 == argc) {
+            break;
+        }
+        if (!strcmp(argv[arg], "--sketch-out")) {
+            sketchOutPath = argv[arg + 1];
+            setSketchesEnabled(true);
+        }
+        // only has an effect in CMD_TRACE builds
+        else if (!strcmp(argv[arg], "--trace-out")) {
+            traceSetOutput(argv[arg + 1]);
+        }
+        // lookup engine for the bulk modes, see engines.h
+        else if (!strcmp(argv[arg], "--engine")) {
+            if (!selectEngine(argv[arg + 1])) {
+                std::cerr << "Unknown engine " << argv[arg + 1] << '\n';
+                return 2;
+            }
+        }
+        else if (!strcmp(argv[arg], "--cross-check")) {
+            setCrossCheck(static_cast<unsigned>(atoi(argv[arg + 1])));
+        }
+        // longest line buffered, see line_reader.h
+        else if (!strcmp(argv[arg], "--max-line")) {
+            setMaxLine(strtoull(argv[arg + 1], nullptr, 10));
+        }
+        else {
+            break;
+        }
+        arg += 2;
+    }
+
+    // --filter splits a command log into valid and invalid lines
+    if (arg < argc && !strcmp(argv[arg], "--filter")) {
+        return finishRun(filterMain(argc - arg - 1, argv + arg + 1));
+    }
+    // --aggregate counts commands per session in time windows
+    if (arg < argc && !strcmp(argv[arg], "--aggregate")) {
+        return finishRun(aggregateMain(argc - arg - 1, argv + arg + 1));
+    }
+    // --server validates lines from AF_UNIX socket clients
+    if (arg < argc && !strcmp(argv[arg], "--server")) {
+        return finishRun(serverMain(argc - arg - 1, argv + arg + 1));
+    }
+    // --generate writes a synthetic command stream
+    if (arg < argc && !strcmp(argv[arg], "--generate")) {
+        return generateMain(argc - arg - 1, argv + arg + 1);
+    }
+    // --harness measures each input mode on a generated stream
+    if (arg < argc && !strcmp(argv[arg], "--harness")) {
+        return finishRun(harnessMain(argc - arg - 1, argv + arg + 1));
+    }
+    // --bench compares the corpus benchmark against its baseline
+    if (arg < argc && !strcmp(argv[arg], "--bench")) {
+        return finishRun(benchMain(argc - arg - 1, argv + arg + 1));
+    }
+    if (arg < argc && !strcmp(argv[arg], "--bench-dispatch")) {
+        return benchDispatchMain(argc - arg - 1, argv + arg + 1);
+    }
+    // --record captures stdin with arrival times, --replay plays it back
+    if (arg < argc && !strcmp(argv[arg], "--record")) {
+        return recordMain(argc - arg - 1, argv + arg + 1);
+    }
+    if (arg < argc && !strcmp(argv[arg], "--replay")) {
+        return finishRun(replayMain(argc - arg - 1, argv + arg + 1));
+    }
+    // --sketch-report merges and prints saved sketches
+    if (arg < argc && !strcmp(argv[arg], "--sketch-report")) {
+        return sketchReportMain(argc - arg - 1, argv + arg + 1);
+    }
+    // --simulate drives simulated players with generated commands
+    if (arg < argc && !strcmp(argv[arg], "--simulate")) {
+        return finishRun(simulateMain(argc - arg - 1, argv + arg + 1));
+    }
+    // --lean is the loop below on raw read()/write(), see lean_io.h
+    if (arg < argc && !strcmp(argv[arg], "--lean")) {
+        return finishRun(leanMain(argc - arg - 1, argv + arg + 1));
+    }
+
     cout << "Welcome to the Command Validator!\n\n";
 
     string input;
+    LineReader reader(cin);
 
-    // 'q' or 'Q' quits
+    // 'q' or 'Q' quits, so does the end of the input
     while (true) {
         cout << "P)lay, pA)use, R)ewind, F)ast-forward, S)top, or Q)uit?: ";
-        getline(cin, input);
+        LineReader::Result got;
+        {
+            ALLOC_SCOPE(ALLOC_GETLINE);
+            TRACE_SCOPE("getline");
+            got = reader.next(input);
+        }
+        if (got == LineReader::END) {
+            break;
+        }
+        handleInputLine(input, got == LineReader::LINE_TOO_LONG);
+    }
+
+    return finishRun(0);
+}
 
-        try {
-            if (validateString(input)) {
+//------------------------------------------------------------------------------
+// - one line as LineReader gave it to the interactive loop, also run
+//   by the harness so it measures the same path
+//------------------------------------------------------------------------------
+void handleInputLine(string& input, bool tooLong) {
+    ALLOC_COUNT_COMMANDS(1);
+
+    // rejected before validation, only a preview is kept
+    if (tooLong) {
+        if (input.size() > TOO_LONG_PREVIEW) {
+            input.resize(TOO_LONG_PREVIEW);
+        }
+        if (sketchesEnabled()) {
+            rejectSketches().add(input);
+        }
+        cout << "Line too long: " << input << "...\n\n";
+        return;
+    }
+
+    if (normalizeOn()) {
+        input.resize(normalizeLine(input.data(), input.size()));
+    }
+
+    handleCommandLine(input);
+}
+
+//------------------------------------------------------------------------------
+// - validates one line read by the interactive loop and prints the
+//   response, catching what validateCommand() throws
+//------------------------------------------------------------------------------
+void handleCommandLine(string& input) {
 
-                // throws InvalidCommandException
-                validateCommand(input);
+    // lines with multibyte characters, all-ASCII ones fall through
+    Command local;
+    if (matchLocalized(input.data(), input.size(), local)) {
+        if (isAccepted(local)) {
+            commandHandlers().dispatch(local, input.data(), input.size());
+        }
+        else {
+            if (sketchesEnabled()) {
+                rejectSketches().add(input);
             }
-            else {
-                cout << "Bad string: " << input << "\n\n";
+            cout << "Bad string: " << input << "\n\n";
+        }
+        return;
+    }
+
+    try {
+        bool valid;
+        {
+            TRACE_SCOPE("validateString");
+            valid = validateString(input);
+        }
+        if (valid) {
+
+            // throws InvalidCommandException
+            validateCommand(input);
+        }
+        else {
+            if (sketchesEnabled()) {
+                rejectSketches().add(input);
             }
+            cout << "Bad string: " << input << "\n\n";
         }
-        // catch specific exception type
-        //catch (InvalidCommandException& e) {
-        //    cout << e.what() << input << "\n\n";
-        //}
-        // catch any std::exception type
-        catch (std::exception& e) {
-            cout << e.what() << ' ' << input << "\n\n";
+    }
+    // catch specific exception type
+    //catch (InvalidCommandException& e) {
+    //    cout << e.what() << input << "\n\n";
+    //}
+    // catch any std::exception type
+    catch (std::exception& e) {
+        TRACE_INSTANT("catch std::exception");
+        if (sketchesEnabled()) {
+            rejectSketches().add(input);
         }
-        // catch any exception type
-        catch (...) {
-            cout << "Unknown non-std::exception\n\n";
+        cout << e.what() << ' ' << input << "\n\n";
+    }
+    // catch any exception type
+    catch (...) {
+        TRACE_INSTANT("catch ...");
+        if (sketchesEnabled()) {
+            rejectSketches().add(input);
         }
+        cout << "Unknown non-std::exception\n\n";
     }
 }
 
@@ -105,6 +281,8 @@ bool validateString(string& str) {
 // makes passed string lowercase
 //------------------------------------------------------------------------------
 string processInput(string& input) {
+    ALLOC_SCOPE(ALLOC_PROCESS_INPUT);
+    TRACE_SCOPE("processInput");
 
     string str;
     for (char c : input) {
@@ -119,39 +297,107 @@ string processInput(string& input) {
 // - throws InvalidCommandException if passed string is not a valid command
 //------------------------------------------------------------------------------
 void validateCommand(string& command) {
+    ALLOC_SCOPE(ALLOC_VALIDATE_COMMAND);
+    TRACE_SCOPE("validateCommand");
 
     //once the string is validated, make it lowercase
     string processed = processInput(command);
+    Command cmd = matchCommand(processed);
+
+    if (!isAccepted(cmd)) {
+        // the input doesn't match any supported command
+        throw InvalidCommandException();
+    }
+
+    // one indirect call; the default quit handler exits, no return.
+    commandHandlers().dispatch(cmd, command.data(), command.size());
+}
+
+//------------------------------------------------------------------------------
+// - returns the opcode for a validated, lowercased command
+// - throws std::out_of_range if the command is empty
+//------------------------------------------------------------------------------
+Command matchCommand(const string& processed) {
+
     char cmdChar = processed.at(0);
 
-    //If block working as a switch statement, outputs lowercase command, returns true.
+    //If block working as a switch statement, returns the command's opcode.
     if (cmdChar == 'p' || !processed.compare("play")) {
-        cout << "play\n\n";
-        return;
+        return CMD_PLAY;
     }
     if (cmdChar == 'a' || !processed.compare("pause")) {
-        cout << "pause\n\n";
-        return;
+        return CMD_PAUSE;
     }
     if (cmdChar == 'r' || !processed.compare("rewind")) {
-        cout << "rewind\n\n";
-        return;
+        return CMD_REWIND;
     }
     if (cmdChar == 'f' || !processed.compare("fast-forward")) {
-        cout << "fast-Forward\n\n";
-        return;
+        return CMD_FAST_FORWARD;
     }
     if (cmdChar == 's' || !processed.compare("stop")) {
-        cout << "stop\n\n";
-        return;
+        return CMD_STOP;
     }
     if (cmdChar == 'q' || !processed.compare("quit")) {
-        //prints "quit" and exits the application, no return.
-        quitFunction();
+        return CMD_QUIT;
+    }
+
+    return CMD_UNRECOGNIZED;
+}
+
+//------------------------------------------------------------------------------
+// - classifies a raw line with the rules of validateString() and
+//   validateCommand(), without copying it or throwing
+// - an empty line passes validateString() but has no first letter,
+//   so it is unrecognized
+//------------------------------------------------------------------------------
+Command classifyCommand(const char* str, size_t len) {
+
+    for (size_t i = 0; i < len; ++i) {
+        unsigned char c = static_cast<unsigned char>(str[i]);
+        if (!isalpha(c) && c != '-') {
+            return CMD_BAD_STRING;
+        }
     }
 
-    // the input doesn't match any supported command
-    throw InvalidCommandException();
+    if (len == 0) {
+        return CMD_UNRECOGNIZED;
+    }
+
+    // every full command name starts with its command letter, so the
+    // first letter decides, as in validateCommand()
+    switch (tolower(static_cast<unsigned char>(str[0]))) {
+    case 'p': return CMD_PLAY;
+    case 'a': return CMD_PAUSE;
+    case 'r': return CMD_REWIND;
+    case 'f': return CMD_FAST_FORWARD;
+    case 's': return CMD_STOP;
+    case 'q': return CMD_QUIT;
+    }
+
+    return CMD_UNRECOGNIZED;
+}
+
+#ifdef __cpp_consteval
+// the command literals must agree with the menu and matchCommand()
+using namespace cmd_literals;
+static_assert("play"_cmd == CMD_PLAY && "P"_cmd == CMD_PLAY);
+// "pause"_cmd does not compile: 'p' is tested first and makes it play
+static_assert("A"_cmd == CMD_PAUSE);
+static_assert("rewind"_cmd == CMD_REWIND && "R"_cmd == CMD_REWIND);
+static_assert("fast-forward"_cmd == CMD_FAST_FORWARD && "F"_cmd == CMD_FAST_FORWARD);
+static_assert("stop"_cmd == CMD_STOP && "S"_cmd == CMD_STOP);
+static_assert("quit"_cmd == CMD_QUIT && "Q"_cmd == CMD_QUIT);
+#endif
+
+//------------------------------------------------------------------------------
+// - returns the text validateCommand() prints for the passed opcode
+//------------------------------------------------------------------------------
+const char* commandName(Command cmd) {
+    static const char* const names[CMD_NUM_COMMANDS] = {
+        "play", "pause", "rewind", "fast-Forward", "stop", "quit"
+    };
+
+    return isAccepted(cmd) ? names[cmd] : "";
 }
 
 //------------------------------------------------------------------------------
@@ -160,5 +406,21 @@ void validateCommand(string& command) {
 int quitFunction() {
     cout << "quit\n\nGoodbye!\n\n";
 
+    finishRun(0);
+
     exit(0);
-}
\ No newline at end of file
+}
+
+//------------------------------------------------------------------------------
+// - writes the rejected-input sketches to the --sketch-out file
+// - an engine mismatch found by --cross-check fails the run
+//------------------------------------------------------------------------------
+static int finishRun(int result) {
+    if (sketchOutPath && !rejectSketches().save(sketchOutPath)) {
+        std::cerr << "Cannot write sketch file " << sketchOutPath << '\n';
+    }
+    if (!reportCrossCheck(std::cerr) && result == 0) {
+        result = 1;
+    }
+    return result;
+}
@@ -0,0 +1,65 @@
+//----------------------------------------------------------------------
+// cmd_validate.h
+//
+// Declarations shared by the command validator source files.
+//----------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <string>
+
+//----------------------------------------------------------------------
+// opcodes for the supported commands, followed by the rejection codes
+//----------------------------------------------------------------------
+enum Command : unsigned char {
+    CMD_PLAY,
+    CMD_PAUSE,
+    CMD_REWIND,
+    CMD_FAST_FORWARD,
+    CMD_STOP,
+    CMD_QUIT,
+
+    // number of real commands, anything at or past this is a rejection
+    CMD_NUM_COMMANDS,
+
+    // validateString() would return false
+    CMD_BAD_STRING = CMD_NUM_COMMANDS,
+    // validateCommand() would throw
+    CMD_UNRECOGNIZED,
+};
+
+// true if the opcode is a real command and not a rejection
+inline bool isAccepted(Command cmd) { return cmd < CMD_NUM_COMMANDS; }
+
+//----------------------------------------------------------------------
+// InvalidCommandException : thrown on bad command input
+//----------------------------------------------------------------------
+class InvalidCommandException : public std::exception {
+public:
+    const char* what() {
+        return "Unrecognized command exception: ";
+    }
+};
+
+// functions defined in cmd_validate.cpp
+void handleInputLine(std::string& input, bool tooLong);
+void handleCommandLine(std::string& input);
+std::string processInput(std::string& userInput);
+bool validateString(std::string& passed);
+
+// this function throws InvalidCommandException exception
+void validateCommand(std::string& command);
+
+// the if-chain of validateCommand(), on a lowercased command
+Command matchCommand(const std::string& processed);
+
+// same rules as validateString() + validateCommand(), but never
+// throws, prints or allocates
+Command classifyCommand(const char* str, size_t len);
+
+// text validateCommand() prints for each opcode
+const char* commandName(Command cmd);
+
+// exits app
+int quitFunction();
@@ -0,0 +1,567 @@
+//----------------------------------------------------------------------
+// coro_server.cpp
+//
+// The pieces, from the bottom up:
+//
+//     Task        a detached coroutine, its frame freed when it ends
+//     Executor    parks awaiters on (fd, events); when poll() reports
+//                 the descriptor ready it lets the awaiter do its I/O
+//                 and resumes the coroutine only once that finished
+//                 the awaited operation
+//     LineSource  read stage: co_await next() gives the next line,
+//                 reading only when no complete line is buffered
+//     LineSink    write stage: answers are queued, co_await flush()
+//                 writes them, suspending only on a full socket
+//
+// and serveConnection() / acceptLoop(), the two coroutine kinds.
+//
+// The answers are server.cpp's, both take their text from
+// server_common.h, but without admission control; --rate and friends
+// need the poll() state machine there.
+// Every line is admitted, so "@stats" only ever counts admissions.
+//----------------------------------------------------------------------
+#include "coro_server.h"
+#include "cmd_validate.h"
+#include "alloc_stats.h"
+#include "envelope.h"
+#include "normalize.h"
+#include "server_common.h"
+#include "sketches.h"
+#include "token_bucket.h"
+#include "vocabulary.h"
+
+#include <iostream>
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::cerr;
+
+#if !defined(_WIN32) && defined(__cpp_impl_coroutine)
+
+#include <cerrno>
+#include <coroutine>
+#include <csignal>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using std::coroutine_handle;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+namespace {
+
+// bytes asked of one read()
+constexpr size_t READ_CHUNK = 4096;
+
+// queued answers are written out once they reach this
+constexpr size_t WRITE_HIGH_WATER = 1 << 14;
+
+volatile sig_atomic_t stopRequested = 0;
+
+extern "C" void onCoroStopSignal(int) {
+    stopRequested = 1;
+}
+
+// lines admitted over all connections
+AdmissionCounters total;
+
+// coroutine frames alive now, and the bytes the largest one took
+size_t liveFrames = 0;
+size_t peakFrames = 0;
+size_t frameBytes = 0;
+
+//----------------------------------------------------------------------
+// Task : fire-and-forget coroutine, started by Executor::spawn()
+//----------------------------------------------------------------------
+class Task {
+public:
+    struct promise_type {
+        Task get_return_object() {
+            return Task(coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+
+        // counts frames, so the per-connection cost can be reported
+        static void* operator new(size_t size) {
+            if (size > frameBytes) {
+                frameBytes = size;
+            }
+            if (++liveFrames > peakFrames) {
+                peakFrames = liveFrames;
+            }
+            return ::operator new(size);
+        }
+        static void operator delete(void* p) {
+            --liveFrames;
+            ::operator delete(p);
+        }
+    };
+
+    Task(Task&& other) noexcept : handle(other.handle) {
+        other.handle = nullptr;
+    }
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    // hands the coroutine over, the caller now owns its frame
+    coroutine_handle<> release() {
+        coroutine_handle<> h = handle;
+        handle = nullptr;
+        return h;
+    }
+
+private:
+    explicit Task(coroutine_handle<promise_type> h) : handle(h) {}
+
+    coroutine_handle<promise_type> handle;
+};
+
+//----------------------------------------------------------------------
+// Waiter : an awaiter parked on a descriptor
+//----------------------------------------------------------------------
+struct Waiter {
+    int fd = -1;
+    short events = 0;
+    coroutine_handle<> handle;
+
+    // - does the I/O once the descriptor is ready
+    // - returns true when the awaited operation is complete
+    virtual bool onReady() = 0;
+
+protected:
+    ~Waiter() = default;
+};
+
+//----------------------------------------------------------------------
+// Executor : one thread, one poll() set
+//----------------------------------------------------------------------
+class Executor {
+public:
+    Executor() = default;
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    // frames still parked at shutdown are destroyed, which runs the
+    // destructors of their locals and so closes their sockets
+    ~Executor() {
+        for (Waiter* w : parked) {
+            w->handle.destroy();
+        }
+    }
+
+    void park(Waiter* w) { parked.push_back(w); }
+
+    // - runs the task until its first suspension
+    void spawn(Task task) { task.release().resume(); }
+
+    // - polls and resumes until nothing is parked or a stop signal
+    void run();
+
+private:
+    vector<Waiter*> parked;
+    vector<Waiter*> polled;
+    vector<pollfd> fds;
+};
+
+void Executor::run() {
+    while (!parked.empty() && !stopRequested) {
+        polled.swap(parked);
+        parked.clear();
+
+        fds.clear();
+        for (const Waiter* w : polled) {
+            fds.push_back({ w->fd, w->events, 0 });
+        }
+
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            parked.swap(polled);
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll");
+            return;
+        }
+
+        // resuming parks coroutines again, so sort out the ready ones
+        // first and resume them after
+        size_t ready = 0;
+        for (size_t i = 0; i < polled.size(); ++i) {
+            if (fds[i].revents && polled[i]->onReady()) {
+                polled[ready++] = polled[i];
+            }
+            else {
+                parked.push_back(polled[i]);
+            }
+        }
+        for (size_t i = 0; i < ready; ++i) {
+            polled[i]->handle.resume();
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// Socket : closes the descriptor when the coroutine frame goes away
+//----------------------------------------------------------------------
+struct Socket {
+    int fd;
+    explicit Socket(int fd) : fd(fd) {}
+    Socket(const Socket&) = delete;
+    ~Socket() { close(fd); }
+};
+
+//----------------------------------------------------------------------
+// LineSource : the read stage
+//----------------------------------------------------------------------
+class LineSource {
+public:
+    enum Result { LINE, TOO_LONG, END };
+
+    LineSource(Executor& ex, int fd, size_t maxLen)
+        : ex(ex), fd(fd), maxLen(maxLen) {}
+
+    struct Next final : Waiter {
+        LineSource& src;
+        Result result = END;
+
+        explicit Next(LineSource& src) : src(src) {}
+
+        // a buffered line is taken without suspending
+        bool await_ready() { return src.take(result); }
+        void await_suspend(coroutine_handle<> h) {
+            fd = src.fd;
+            events = POLLIN;
+            handle = h;
+            src.ex.park(this);
+        }
+        Result await_resume() const { return result; }
+
+        bool onReady() override { return src.fill() && src.take(result); }
+    };
+
+    // - awaits the next line, reading as needed
+    // - a TOO_LONG line without its newline yet is cut short
+    Next next() { return Next(*this); }
+
+    // true if next() can complete without reading
+    bool buffered() const {
+        return eof || buf.find('\n', consumed) != string::npos;
+    }
+
+    // the line from the last next(), valid until the next one
+    char* line() { return buf.data() + lineStart; }
+    size_t length() const { return lineLen; }
+
+private:
+    Executor& ex;
+    int fd;
+    size_t maxLen;
+
+    string buf;                     // bytes read, from consumed on unused
+    size_t consumed = 0;
+    size_t lineStart = 0;
+    size_t lineLen = 0;
+    bool eof = false;
+    bool skipping = false;          // dropping the rest of a long line
+
+    bool take(Result& result);
+    bool fill();
+};
+
+//------------------------------------------------------------------------------
+// - takes the next complete line, or the rest of the input at eof
+// - returns false if more input is needed
+//------------------------------------------------------------------------------
+bool LineSource::take(Result& result) {
+    while (true) {
+        size_t nl = buf.find('\n', consumed);
+
+        if (skipping) {
+            if (nl == string::npos) {
+                consumed = buf.size();
+                if (!eof) {
+                    return false;
+                }
+                result = END;
+                return true;
+            }
+            consumed = nl + 1;
+            skipping = false;
+            continue;
+        }
+
+        lineStart = consumed;
+        if (nl != string::npos) {
+            lineLen = nl - consumed;
+            consumed = nl + 1;
+            result = lineLen > maxLen ? TOO_LONG : LINE;
+            return true;
+        }
+
+        size_t rest = buf.size() - consumed;
+        if (rest > maxLen) {
+            // answered now, the rest is dropped as it arrives
+            lineLen = rest;
+            consumed = buf.size();
+            skipping = true;
+            result = TOO_LONG;
+            return true;
+        }
+        if (eof) {
+            lineLen = rest;
+            consumed = buf.size();
+            result = rest ? LINE : END;
+            return true;
+        }
+        return false;
+    }
+}
+
+//------------------------------------------------------------------------------
+// - one read(), after dropping the lines already taken
+// - returns false if nothing changed and the coroutine should wait on
+//------------------------------------------------------------------------------
+bool LineSource::fill() {
+    // only called once the last line taken has been answered
+    buf.erase(0, consumed);
+    consumed = 0;
+
+    char chunk[READ_CHUNK];
+    ssize_t n = read(fd, chunk, sizeof chunk);
+    if (n > 0) {
+        buf.append(chunk, n);
+        return true;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+        return false;
+    }
+    eof = true;
+    return true;
+}
+
+//----------------------------------------------------------------------
+// LineSink : the write stage
+//----------------------------------------------------------------------
+class LineSink {
+public:
+    LineSink(Executor& ex, int fd) : ex(ex), fd(fd) {}
+
+    struct Flush final : Waiter {
+        LineSink& sink;
+
+        explicit Flush(LineSink& sink) : sink(sink) {}
+
+        bool await_ready() { return sink.writeSome(); }
+        void await_suspend(coroutine_handle<> h) {
+            fd = sink.fd;
+            events = POLLOUT;
+            handle = h;
+            sink.ex.park(this);
+        }
+        void await_resume() const {}
+
+        bool onReady() override { return sink.writeSome(); }
+    };
+
+    // answers not yet written, the server_common.h helpers append here
+    string& queue() { return out; }
+
+    bool full() const { return out.size() >= WRITE_HIGH_WATER; }
+    bool empty() const { return out.empty(); }
+    bool failed() const { return broken; }
+
+    // - awaits the write of everything queued
+    Flush flush() { return Flush(*this); }
+
+private:
+    Executor& ex;
+    int fd;
+    string out;
+    bool broken = false;
+
+    // - writes what the socket takes
+    // - returns true once nothing is left or the peer is gone
+    bool writeSome();
+};
+
+bool LineSink::writeSome() {
+    while (!out.empty() && !broken) {
+        ssize_t n = write(fd, out.data(), out.size());
+        if (n > 0) {
+            out.erase(0, n);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+            return false;
+        }
+        broken = true;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------
+// - the validation stage: answers one line into the sink
+// - returns false once the connection should close
+//----------------------------------------------------------------------
+bool answerLine(LineSink& sink, const VocabularyRegistry& vocabs,
+    shared_ptr<const CompiledVocabulary>& vocab, AdmissionCounters& mine,
+    const char* line, size_t len) {
+
+    ALLOC_COUNT_COMMANDS(1);
+    ++mine.admitted;
+    ++total.admitted;
+
+    // nothing is shed, deferred or aged here, those counters stay 0
+    if (len == 6 && !memcmp(line, "@stats", 6)) {
+        appendStats(sink.queue(), mine, total, 0, 0);
+        return true;
+    }
+
+    if (len >= 6 && !memcmp(line, "@vocab", 6) && (len == 6 || line[6] == ' ')) {
+        size_t skip = len == 6 ? 6 : 7;
+        bindVocabulary(sink.queue(), vocabs, vocab, line + skip, len - skip);
+        return true;
+    }
+
+    // only the command after the envelope fields is validated
+    Envelope env = parseEnvelope(line, len);
+    Command cmd = classifyWithVocabulary(vocab.get(), env.command,
+        env.commandLen);
+    if (!isAccepted(cmd) && sketchesEnabled()) {
+        rejectSketches().add(env.command, env.commandLen);
+    }
+    appendAnswer(sink.queue(), line, len, cmd);
+    return cmd != CMD_QUIT;
+}
+
+//----------------------------------------------------------------------
+// - one client: read, validate and answer until quit or end of input
+//----------------------------------------------------------------------
+Task serveConnection(Executor& ex, int fd, const VocabularyRegistry& vocabs,
+    size_t maxLen) {
+
+    Socket sock(fd);
+    LineSource source(ex, fd, maxLen);
+    LineSink sink(ex, fd);
+    shared_ptr<const CompiledVocabulary> vocab;
+    AdmissionCounters counters;
+
+    bool open = true;
+    while (open && !sink.failed()) {
+        // answers go out in one write before we wait for more input
+        if (!source.buffered() || sink.full()) {
+            co_await sink.flush();
+        }
+
+        LineSource::Result got = co_await source.next();
+        if (got == LineSource::END) {
+            break;
+        }
+
+        if (got == LineSource::TOO_LONG) {
+            appendTooLong(sink.queue(), source.line(), source.length());
+            continue;
+        }
+
+        size_t len = source.length();
+        if (normalizeOn()) {
+            len = normalizeLine(source.line(), len);
+        }
+        open = answerLine(sink, vocabs, vocab, counters, source.line(), len);
+    }
+
+    co_await sink.flush();
+}
+
+//----------------------------------------------------------------------
+// Accept : awaits the next client on the listener
+//----------------------------------------------------------------------
+struct Accept final : Waiter {
+    Executor& ex;
+    int client = -1;
+
+    Accept(Executor& ex, int listenFd) : ex(ex) {
+        fd = listenFd;
+        events = POLLIN;
+    }
+
+    bool await_ready() { return onReady(); }
+    void await_suspend(coroutine_handle<> h) {
+        handle = h;
+        ex.park(this);
+    }
+    int await_resume() const { return client; }
+
+    bool onReady() override {
+        client = accept(fd, nullptr, nullptr);
+        return client >= 0;
+    }
+};
+
+//----------------------------------------------------------------------
+// - accepts clients and spawns a serveConnection() for each
+//----------------------------------------------------------------------
+Task acceptLoop(Executor& ex, int listenFd, const VocabularyRegistry& vocabs,
+    size_t maxLen) {
+
+    while (true) {
+        int fd = co_await Accept(ex, listenFd);
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        ex.spawn(serveConnection(ex, fd, vocabs, maxLen));
+    }
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// - entry point for --server <path> --coro
+//------------------------------------------------------------------------------
+int runCoroServer(const char* socketPath, const VocabularyRegistry& vocabs,
+    size_t maxLine) {
+
+    int listenFd = openListener(socketPath);
+    if (listenFd < 0) {
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, onCoroStopSignal);
+    signal(SIGTERM, onCoroStopSignal);
+
+    {
+        Executor ex;
+        ex.spawn(acceptLoop(ex, listenFd, vocabs, maxLine));
+        ex.run();
+    }
+
+    close(listenFd);
+    unlink(socketPath);
+
+    cerr << "coroutine frames: peak " << peakFrames << " live, "
+        << frameBytes << " bytes for the largest\n";
+    return 0;
+}
+#else
+//------------------------------------------------------------------------------
+// - needs POSIX sockets and poll(), and compiler coroutine support
+//------------------------------------------------------------------------------
+int runCoroServer(const char*, const VocabularyRegistry&, size_t) {
+    cerr << "Coroutine server mode is not available in this build\n";
+    return 1;
+}
+#endif
@@ -0,0 +1,24 @@
+//----------------------------------------------------------------------
+// coro_server.h
+//
+// Server mode as a C++20 coroutine pipeline on a single-threaded
+// poll() executor, selected with --server <path> --coro.
+//
+// Each connection is one coroutine that awaits its next line, checks
+// it, and awaits the write of the answer. Validation runs inline, so
+// a connection is suspended only while it waits for the socket, and
+// a parked connection costs its coroutine frame plus its buffers.
+//----------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+
+class VocabularyRegistry;
+
+//----------------------------------------------------------------------
+// - serves clients on the AF_UNIX socket until SIGINT or SIGTERM
+// - lines over maxLine are answered as too long, see line_reader.h
+// - returns the process exit code
+//----------------------------------------------------------------------
+int runCoroServer(const char* socketPath, const VocabularyRegistry& vocabs,
+    size_t maxLine);
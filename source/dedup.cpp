@@ -0,0 +1,136 @@
+//----------------------------------------------------------------------
+// dedup.cpp
+//
+// The window is a shift register: a new highest seq shifts the seen
+// bitmap and the result planes up, so seq maxSeq - d is always bit d
+// and sliding costs three shifts.
+//----------------------------------------------------------------------
+#include "dedup.h"
+
+static_assert(CMD_UNRECOGNIZED < 8, "results are stored in 3 bits");
+
+namespace {
+
+uint64_t mixSession(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+} // namespace
+
+DedupTable::DedupTable(size_t maxSessions) {
+    size_t buckets = 1;
+    while (buckets * WAYS < maxSessions) {
+        buckets *= 2;
+    }
+    entries.assign(buckets * WAYS, Entry{});
+    bucketMask = buckets - 1;
+}
+
+//------------------------------------------------------------------------------
+// - the session's entry, or a cleared one that now belongs to it
+//------------------------------------------------------------------------------
+DedupTable::Entry* DedupTable::bucketOf(uint64_t session) {
+    return &entries[(mixSession(session) & bucketMask) * WAYS];
+}
+
+DedupTable::Entry& DedupTable::find(uint64_t session) {
+    Entry* bucket = bucketOf(session);
+
+    // the clock only orders entries, a wrap just makes the next few
+    // victims arbitrary
+    if (++clock == 0) {
+        clock = 1;
+    }
+
+    Entry* victim = bucket;
+    for (unsigned w = 0; w < WAYS; ++w) {
+        Entry& e = bucket[w];
+        if (e.lastUse && e.session == session) {
+            e.lastUse = clock;
+            return e;
+        }
+        if (victim->lastUse && (!e.lastUse || e.lastUse < victim->lastUse)) {
+            victim = &e;
+        }
+    }
+
+    if (victim->lastUse) {
+        ++evicted;
+    }
+    *victim = Entry{};
+    victim->session = session;
+    victim->lastUse = clock;
+    return *victim;
+}
+
+DedupTable::Verdict DedupTable::check(uint64_t session, uint64_t seq,
+    Command& stored) {
+
+    Entry& e = find(session);
+
+    // first seq of a session, or a new highest one
+    if (!e.seen || seq > e.maxSeq) {
+        uint64_t shift = e.seen ? seq - e.maxSeq : WINDOW;
+        for (uint64_t* bits : { &e.seen, &e.planes[0], &e.planes[1],
+            &e.planes[2] }) {
+            *bits = shift < WINDOW ? *bits << shift : 0;
+        }
+        e.maxSeq = seq;
+        e.seen |= 1;
+        last = &e;
+        lastDistance = 0;
+        return FIRST;
+    }
+
+    uint64_t distance = e.maxSeq - seq;
+    if (distance >= WINDOW) {
+        return TOO_OLD;
+    }
+
+    uint64_t bit = uint64_t(1) << distance;
+    if (e.seen & bit) {
+        unsigned result = 0;
+        for (unsigned k = 0; k < 3; ++k) {
+            result |= static_cast<unsigned>(e.planes[k] >> distance & 1) << k;
+        }
+        stored = static_cast<Command>(result);
+        return DUPLICATE;
+    }
+
+    e.seen |= bit;
+    last = &e;
+    lastDistance = static_cast<unsigned>(distance);
+    return FIRST;
+}
+
+void DedupTable::forget(uint64_t session) {
+    Entry* bucket = bucketOf(session);
+    for (unsigned w = 0; w < WAYS; ++w) {
+        if (bucket[w].lastUse && bucket[w].session == session) {
+            if (last == &bucket[w]) {
+                last = nullptr;
+            }
+            bucket[w] = Entry{};
+            return;
+        }
+    }
+}
+
+void DedupTable::store(Command result) {
+    if (!last) {
+        return;
+    }
+
+    uint64_t bit = uint64_t(1) << lastDistance;
+    for (unsigned k = 0; k < 3; ++k) {
+        if (result >> k & 1) {
+            last->planes[k] |= bit;
+        }
+    }
+    last = nullptr;
+}
@@ -0,0 +1,79 @@
+//----------------------------------------------------------------------
+// dedup.h
+//
+// Exactly-once answers for retried commands. Lines that carry both
+// s=<session> and n=<seq> envelope fields (see envelope.h) are looked
+// up by (session, seq): a retry of a command seen before gets the
+// stored result, without being validated or dispatched again.
+//
+// Each session keeps a sliding window of the WINDOW sequence numbers
+// up to the highest it has sent: one bitmap of the ones seen, and the
+// opcode of each as three bit planes, 40 bytes of window per session.
+// A sequence number that fell out of the window cannot be checked and
+// is reported as too old rather than run twice.
+//
+// Sessions live in a fixed set-associative table: a session hashes to
+// one bucket of WAYS entries, and a new session takes the least
+// recently used entry of a full bucket. Memory is fixed by the table
+// size, however many sessions come and go; an evicted session starts
+// a fresh window when it returns.
+//----------------------------------------------------------------------
+#pragma once
+
+#include "cmd_validate.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class DedupTable {
+public:
+    // sequence numbers remembered per session
+    static constexpr unsigned WINDOW = 64;
+
+    // entries per bucket
+    static constexpr unsigned WAYS = 4;
+
+    enum Verdict {
+        FIRST,                      // not seen, now marked as seen
+        DUPLICATE,                  // seen, `stored` holds its result
+        TOO_OLD                     // below the window, cannot tell
+    };
+
+    // - room for at least maxSessions sessions
+    explicit DedupTable(size_t maxSessions);
+
+    // - looks (session, seq) up and marks it seen
+    // - after FIRST, call store() with the result before the next check()
+    Verdict check(uint64_t session, uint64_t seq, Command& stored);
+
+    // - records the result for the (session, seq) of the last FIRST
+    void store(Command result);
+
+    // - drops a session's window, e.g. when the session expires
+    void forget(uint64_t session);
+
+    size_t capacity() const { return entries.size(); }
+    size_t bytes() const { return entries.size() * sizeof(Entry); }
+    uint64_t evictions() const { return evicted; }
+
+private:
+    struct Entry {
+        uint64_t session;
+        uint64_t maxSeq;            // highest seq seen, bit 0 below
+        uint64_t seen;              // bit d: maxSeq - d was seen
+        uint64_t planes[3];         // bit d of plane k: bit k of result
+        uint32_t lastUse;           // 0 = empty
+    };
+
+    std::vector<Entry> entries;     // buckets of WAYS entries
+    size_t bucketMask;
+    uint32_t clock = 0;
+    uint64_t evicted = 0;
+
+    Entry* last = nullptr;          // where the last FIRST was marked
+    unsigned lastDistance = 0;
+
+    Entry& find(uint64_t session);
+    Entry* bucketOf(uint64_t session);
+};
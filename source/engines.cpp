@@ -0,0 +1,233 @@
+//----------------------------------------------------------------------
+// engines.cpp
+//
+// Lookup engines behind classifyLine().
+//
+// The selected engine is a function pointer, so a call costs one
+// indirect jump whichever engine runs.
+//----------------------------------------------------------------------
+#include "engines.h"
+#include "localized.h"
+#include "validator.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::ostream;
+using std::string;
+
+namespace {
+
+using EngineFn = Command (*)(const char*, size_t);
+
+// mismatches printed in full before only being counted
+constexpr unsigned MAX_MISMATCHES_SHOWN = 10;
+
+// adaptive engine: lines sampled before each choice
+constexpr unsigned ADAPT_SAMPLE = 1024;
+// adaptive engine: lines between re-sampling
+constexpr unsigned ADAPT_PERIOD = 1 << 16;
+// adaptive engine: mean length from which the table engine wins
+constexpr size_t ADAPT_LONG_LINE = 24;
+
+//----------------------------------------------------------------------
+// reference engine
+//----------------------------------------------------------------------
+Command referenceEngine(const char* str, size_t len) {
+    string input(str, len);
+    if (!validateString(input)) {
+        return CMD_BAD_STRING;
+    }
+
+    // matchCommand() would throw std::out_of_range
+    if (input.empty()) {
+        return CMD_UNRECOGNIZED;
+    }
+    return matchCommand(processInput(input));
+}
+
+//----------------------------------------------------------------------
+// table engine
+//----------------------------------------------------------------------
+struct Tables {
+    unsigned char bad[256];             // 1 unless [A-Za-z-]
+    unsigned char opcode[256];          // by first byte
+
+    Tables() {
+        for (int c = 0; c < 256; ++c) {
+            bad[c] = !(isalpha(c) || c == '-');
+            opcode[c] = CMD_UNRECOGNIZED;
+        }
+
+        const char letters[] = "pArfsq";
+        for (int i = 0; i < CMD_NUM_COMMANDS; ++i) {
+            unsigned char lower = tolower(letters[i]);
+            opcode[lower] = static_cast<unsigned char>(i);
+            opcode[toupper(lower)] = static_cast<unsigned char>(i);
+        }
+    }
+};
+
+const Tables tables;
+
+Command tableEngine(const char* str, size_t len) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(str);
+
+    // no early exit, so the loop has no data-dependent branch
+    unsigned bad = 0;
+    for (size_t i = 0; i < len; ++i) {
+        bad |= tables.bad[p[i]];
+    }
+
+    if (bad) {
+        return CMD_BAD_STRING;
+    }
+    if (len == 0) {
+        return CMD_UNRECOGNIZED;
+    }
+    return static_cast<Command>(tables.opcode[p[0]]);
+}
+
+//----------------------------------------------------------------------
+// adaptive engine
+//----------------------------------------------------------------------
+struct Adaptive {
+    EngineFn current = classifyCommand;
+    unsigned seen = 0;
+    size_t sampledBytes = 0;
+};
+
+Adaptive adaptive;
+
+Command adaptiveEngine(const char* str, size_t len) {
+    unsigned n = adaptive.seen++;
+
+    if (n < ADAPT_SAMPLE) {
+        adaptive.sampledBytes += len;
+    }
+    else if (n == ADAPT_SAMPLE) {
+        adaptive.current = adaptive.sampledBytes / ADAPT_SAMPLE
+            >= ADAPT_LONG_LINE ? tableEngine : classifyCommand;
+        adaptive.sampledBytes = 0;
+    }
+    else if (n == ADAPT_PERIOD) {
+        adaptive.seen = 0;
+    }
+
+    return adaptive.current(str, len);
+}
+
+//----------------------------------------------------------------------
+// engine registry
+//----------------------------------------------------------------------
+struct EngineEntry {
+    const char* name;
+    EngineFn fn;
+    bool sameRules = true;          // false: differs from reference
+};
+
+const EngineEntry ENGINES[] = {
+    { "reference", referenceEngine },
+    { "switch", classifyCommand },
+    { "table", tableEngine },
+    { "adaptive", adaptiveEngine },
+
+    // policy-based configurations, see validator.h
+    { "classic", ClassicValidator::classify },
+    { "strict", StrictValidator::classify, false },
+    { "abbrev", AbbrevValidator::classify, false },
+};
+
+const EngineEntry* selected = &ENGINES[1];
+
+//----------------------------------------------------------------------
+// cross-check state
+//----------------------------------------------------------------------
+struct CrossCheck {
+    unsigned every = 0;
+    unsigned countdown = 0;
+    unsigned long long checked = 0;
+    unsigned long long mismatches = 0;
+};
+
+CrossCheck cross;
+
+//----------------------------------------------------------------------
+// - runs the reference engine too and reports disagreement
+// - an engine with narrower rules keeps its own answer, a mismatch
+//   there is a difference to list, not a wrong answer
+//----------------------------------------------------------------------
+Command crossChecked(const char* str, size_t len) {
+    Command cmd = selected->fn(str, len);
+    Command ref = referenceEngine(str, len);
+    ++cross.checked;
+
+    if (cmd != ref) {
+        if (cross.mismatches < MAX_MISMATCHES_SHOWN) {
+            fprintf(stderr, "engine %s mismatch: \"%.*s\" gave %d, "
+                "reference gave %d\n", selected->name,
+                static_cast<int>(len), str, cmd, ref);
+        }
+        ++cross.mismatches;
+    }
+
+    // otherwise the reference answer is the one we trust
+    return selected->sameRules ? ref : cmd;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+bool selectEngine(const char* name) {
+    for (const EngineEntry& e : ENGINES) {
+        if (!strcmp(e.name, name)) {
+            selected = &e;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* engineName() {
+    return selected->name;
+}
+
+void setCrossCheck(unsigned every) {
+    cross.every = every;
+    cross.countdown = every;
+}
+
+//------------------------------------------------------------------------------
+// - classifies a multibyte line with the localized vocabulary, and
+//   any other with the selected engine, cross-checking on schedule
+//------------------------------------------------------------------------------
+Command classifyLine(const char* str, size_t len) {
+    // only lines with multibyte characters are decided here
+    Command local;
+    if (matchLocalized(str, len, local)) {
+        return local;
+    }
+
+    if (cross.every && --cross.countdown == 0) {
+        cross.countdown = cross.every;
+        return crossChecked(str, len);
+    }
+    return selected->fn(str, len);
+}
+
+bool reportCrossCheck(ostream& out) {
+    if (!cross.every) {
+        return true;
+    }
+
+    out << "cross-check of engine " << selected->name << ": "
+        << cross.checked << " lines checked, "
+        << cross.mismatches << " mismatches"
+        << (selected->sameRules ? "\n" : " (narrower rules, expected)\n");
+    return cross.mismatches == 0 || !selected->sameRules;
+}
@@ -0,0 +1,48 @@
+//----------------------------------------------------------------------
+// engines.h
+//
+// Interchangeable command lookup engines, chosen at runtime.
+//
+// Every engine implements the rules of validateString() and
+// validateCommand() and must give the same opcode for every line:
+//
+//     reference   the real validateString()/processInput()/
+//                 matchCommand() code, with its string copies
+//     switch      classifyCommand(): early-exit scan, then a switch
+//     table       byte-class tables, one pass without branches
+//     adaptive    switch or table, picked from the line lengths seen
+//     classic     ClassicValidator, the same rules from policies
+//
+// The strict and abbrev engines (StrictValidator, AbbrevValidator)
+// implement deliberately narrower rules for other deployments, so a
+// cross-check of them lists exactly where they differ. Those lines keep
+// the engine's answer and do not fail the run.
+//
+// Cross-checking runs the reference engine next to the chosen one on
+// one line in N and reports any line where they disagree.
+//----------------------------------------------------------------------
+#pragma once
+
+#include "cmd_validate.h"
+
+#include <cstddef>
+#include <ostream>
+
+// - selects the engine by name
+// - returns false for an unknown name
+bool selectEngine(const char* name);
+
+// name of the selected engine
+const char* engineName();
+
+// cross-checks one line in every `every`, 0 turns it off
+void setCrossCheck(unsigned every);
+
+// - classifies a line with the selected engine
+// - localized names (see localized.h) are matched first
+Command classifyLine(const char* str, size_t len);
+
+// - prints the cross-check summary, if cross-checking was on
+// - returns false if there were mismatches in an engine that should
+//   agree with the reference
+bool reportCrossCheck(std::ostream& out);
@@ -0,0 +1,86 @@
+//----------------------------------------------------------------------
+// envelope.cpp
+//
+// Parses the optional s=, t= and n= fields in front of a command.
+//----------------------------------------------------------------------
+#include "envelope.h"
+
+#include <chrono>
+
+namespace {
+
+//----------------------------------------------------------------------
+// - parses the decimal digits in [p, end) into value
+// - returns false if the range is empty or has a non-digit
+//----------------------------------------------------------------------
+bool parseNumber(const char* p, const char* end, uint64_t& value) {
+    if (p == end) {
+        return false;
+    }
+
+    uint64_t v = 0;
+    for (; p < end; ++p) {
+        if (*p < '0' || *p > '9') {
+            return false;
+        }
+        v = v * 10 + (*p - '0');
+    }
+
+    value = v;
+    return true;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// - consumes "x=<digits> " tokens from the front of the line
+//------------------------------------------------------------------------------
+Envelope parseEnvelope(const char* line, size_t len) {
+    Envelope env;
+    const char* p = line;
+    const char* end = line + len;
+
+    while (end - p > 2 && p[1] == '=') {
+        const char* value = p + 2;
+        const char* space = value;
+        while (space < end && *space != ' ') {
+            ++space;
+        }
+        if (space == end) {
+            break;
+        }
+
+        uint64_t number;
+        if (!parseNumber(value, space, number)) {
+            break;
+        }
+
+        if (p[0] == 's') {
+            env.session = number;
+            env.hasSession = true;
+        }
+        else if (p[0] == 't') {
+            env.timeMs = number;
+            env.hasTime = true;
+        }
+        else if (p[0] == 'n') {
+            env.seq = number;
+            env.hasSeq = true;
+        }
+        else {
+            break;
+        }
+
+        p = space + 1;
+    }
+
+    env.command = p;
+    env.commandLen = end - p;
+    return env;
+}
+
+uint64_t wallClockMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(
+        system_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,45 @@
+//----------------------------------------------------------------------
+// envelope.h
+//
+// Optional fields in front of a command on an input line:
+//
+//     s=<session> t=<time-ms> n=<seq> <command>
+//
+// Each field may be left out and they may come in any order. A
+// command cannot contain '=' or spaces, so the command is whatever
+// follows the last field.
+//
+// t= is when the command was sent, in milliseconds since the Unix
+// epoch (wallClockMs()). The generator stamps it that way, the server
+// ages lines against it and --aggregate windows it.
+//----------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//----------------------------------------------------------------------
+// Envelope : the fields of one input line, pointing into that line
+//----------------------------------------------------------------------
+struct Envelope {
+    bool hasSession = false;
+    bool hasTime = false;
+    bool hasSeq = false;
+
+    uint64_t session = 0;
+    uint64_t timeMs = 0;
+    uint64_t seq = 0;
+
+    const char* command = nullptr;
+    size_t commandLen = 0;
+};
+
+//----------------------------------------------------------------------
+// - splits the envelope fields off the front of a line
+// - a token that looks like a field but has a bad value is left in
+//   place as the command, so the validator rejects it
+//----------------------------------------------------------------------
+Envelope parseEnvelope(const char* line, size_t len);
+
+// milliseconds since the Unix epoch, the clock t= fields use
+uint64_t wallClockMs();
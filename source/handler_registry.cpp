@@ -0,0 +1,69 @@
+//----------------------------------------------------------------------
+// handler_registry.cpp
+//
+// Handler registry and the default handlers of the interactive app.
+//----------------------------------------------------------------------
+#include "handler_registry.h"
+
+#include <iostream>
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::cout;
+
+namespace {
+
+//----------------------------------------------------------------------
+// default handlers
+//----------------------------------------------------------------------
+void printCommand(void*, Command cmd, const char*, size_t) {
+    cout << commandName(cmd) << "\n\n";
+}
+
+void quitCommand(void*, Command, const char*, size_t) {
+    //prints "quit" and exits the application, no return.
+    quitFunction();
+}
+
+void ignoreLine(void*, Command, const char*, size_t) {
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// - every slot starts out doing nothing
+//------------------------------------------------------------------------------
+HandlerRegistry::HandlerRegistry() {
+    for (size_t i = 0; i < SLOTS; ++i) {
+        set(static_cast<Command>(i), ignoreLine);
+    }
+}
+
+void HandlerRegistry::set(Command cmd, HandlerFn fn, void* context) {
+    struct Bound {
+        HandlerFn fn;
+        void* context;
+    };
+    static_assert(sizeof(Bound) <= SLOT_BYTES, "slot too small");
+
+    Slot& s = slots[cmd];
+    new (s.storage) Bound{ fn, context };
+    s.call = [](Slot& self, Command c, const char* line, size_t len) {
+        Bound& b = *std::launder(reinterpret_cast<Bound*>(self.storage));
+        b.fn(b.context, c, line, len);
+    };
+}
+
+//------------------------------------------------------------------------------
+HandlerRegistry& commandHandlers() {
+    static HandlerRegistry registry = [] {
+        HandlerRegistry r;
+        for (int cmd = 0; cmd < CMD_NUM_COMMANDS; ++cmd) {
+            r.set(static_cast<Command>(cmd), printCommand);
+        }
+        r.set(CMD_QUIT, quitCommand);
+        return r;
+    }();
+    return registry;
+}
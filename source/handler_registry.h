@@ -0,0 +1,77 @@
+//----------------------------------------------------------------------
+// handler_registry.h
+//
+// Opcode-indexed table of command handlers.
+//
+// Each slot holds a small callable stored in place: a plain function
+// pointer with a context pointer, or a lambda that fits in the slot.
+// Dispatch indexes the table by opcode and makes one indirect call,
+// with no allocation and no std::function.
+//
+// The rejection codes have slots too, so bad lines can be routed the
+// same way as commands.
+//----------------------------------------------------------------------
+#pragma once
+
+#include "cmd_validate.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+//----------------------------------------------------------------------
+// HandlerRegistry
+//----------------------------------------------------------------------
+class HandlerRegistry {
+public:
+    // largest lambda capture a slot can hold
+    static constexpr size_t SLOT_BYTES = 2 * sizeof(void*);
+
+    using HandlerFn = void (*)(void* context, Command cmd,
+        const char* line, size_t len);
+
+    // one slot per opcode and rejection code
+    static constexpr size_t SLOTS = CMD_UNRECOGNIZED + 1;
+
+    HandlerRegistry();
+
+    // - installs a function pointer and the context passed back to it
+    void set(Command cmd, HandlerFn fn, void* context = nullptr);
+
+    // - installs a callable taking (Command, const char*, size_t)
+    // - it must be trivially copyable and fit in SLOT_BYTES
+    template <typename F>
+    void set(Command cmd, F f) {
+        static_assert(sizeof(F) <= SLOT_BYTES, "handler too large");
+        static_assert(alignof(F) <= alignof(void*), "handler overaligned");
+        static_assert(std::is_trivially_copyable<F>::value
+            && std::is_trivially_destructible<F>::value,
+            "handler must be trivially copyable");
+
+        Slot& s = slots[cmd];
+        new (s.storage) F(f);
+        s.call = [](Slot& self, Command c, const char* line, size_t len) {
+            (*std::launder(reinterpret_cast<F*>(self.storage)))(c, line, len);
+        };
+    }
+
+    void dispatch(Command cmd, const char* line, size_t len) {
+        Slot& s = slots[cmd];
+        s.call(s, cmd, line, len);
+    }
+
+private:
+    struct Slot {
+        alignas(void*) unsigned char storage[SLOT_BYTES];
+        void (*call)(Slot& self, Command cmd, const char* line, size_t len);
+    };
+
+    Slot slots[SLOTS];
+};
+
+//----------------------------------------------------------------------
+// - the registry validateCommand() dispatches to
+// - by default every command prints its name, as the menu expects,
+//   and quit prints and exits
+//----------------------------------------------------------------------
+HandlerRegistry& commandHandlers();
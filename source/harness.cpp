@@ -0,0 +1,391 @@
+//----------------------------------------------------------------------
+// harness.cpp
+//
+// Runs a generated stream through the validator's input modes:
+//
+//     interactive   LineReader + handleInputLine(), output discarded
+//     batch         filter mode reading the file in blocks
+//     mmap          filter mode over a mapping of the file
+//     socket        a forked --server child, over an AF_UNIX socket
+//
+// Latency is measured per line where a line has its own answer: in
+// the interactive loop around each line, and for the socket as the
+// round trip of single lines sent one at a time after the throughput
+// run. The filter modes work on whole blocks, so they report none.
+//
+// There is no shared-memory input mode in this tree to measure. mmap
+// is the nearest: the input is read straight from the page cache.
+//----------------------------------------------------------------------
+#include "harness.h"
+#include "cmd_validate.h"
+#include "line_filter.h"
+#include "line_reader.h"
+#include "loadgen.h"
+#include "server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::cerr;
+using std::cout;
+using std::string;
+using std::vector;
+
+namespace {
+
+#ifdef _WIN32
+const char* const NULL_DEVICE = "NUL";
+#else
+const char* const NULL_DEVICE = "/dev/null";
+#endif
+
+// lines sent one at a time to measure socket round trips
+constexpr size_t LATENCY_SAMPLES = 20000;
+
+using Clock = std::chrono::steady_clock;
+
+uint64_t elapsedNs(Clock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - since).count();
+}
+
+double cpuSeconds() {
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+//----------------------------------------------------------------------
+// ModeResult : one row of the report
+//----------------------------------------------------------------------
+struct ModeResult {
+    const char* mode;
+    uint64_t lines = 0;
+    double wallSec = 0;
+    double cpuSec = 0;
+    vector<uint64_t> latencyNs;
+    bool ran = false;
+};
+
+//----------------------------------------------------------------------
+// - the interactive loop body, one line at a time, cout discarded
+//----------------------------------------------------------------------
+void runInteractive(const string& stream, ModeResult& r) {
+    std::istringstream in(stream);
+    NullBuffer null;
+    std::streambuf* saved = cout.rdbuf(&null);
+
+    r.latencyNs.reserve(static_cast<size_t>(r.lines));
+    double cpu = cpuSeconds();
+    Clock::time_point start = Clock::now();
+
+    string input;
+    LineReader reader(in);
+    while (true) {
+        Clock::time_point lineStart = Clock::now();
+        LineReader::Result got = reader.next(input);
+        if (got == LineReader::END) {
+            break;
+        }
+        handleInputLine(input, got == LineReader::LINE_TOO_LONG);
+        r.latencyNs.push_back(elapsedNs(lineStart));
+    }
+
+    r.wallSec = elapsedNs(start) / 1e9;
+    r.cpuSec = cpuSeconds() - cpu;
+    cout.rdbuf(saved);
+    r.ran = true;
+}
+
+//----------------------------------------------------------------------
+// - filter mode over the stream file, both outputs discarded
+//----------------------------------------------------------------------
+void runFilter(FILE* file, bool useMmap, ModeResult& r) {
+    FILE* null = fopen(NULL_DEVICE, "wb");
+    if (!null) {
+        return;
+    }
+    rewind(file);
+
+    FilterCounts counts;
+    double cpu = cpuSeconds();
+    Clock::time_point start = Clock::now();
+
+    r.ran = filterLines(file, null, null, useMmap, counts);
+
+    r.wallSec = elapsedNs(start) / 1e9;
+    r.cpuSec = cpuSeconds() - cpu;
+    fclose(null);
+}
+
+#ifndef _WIN32
+//----------------------------------------------------------------------
+// - connects to the socket, retrying while the server starts
+//----------------------------------------------------------------------
+int connectTo(const string& path) {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof addr.sun_path - 1);
+
+    for (int attempt = 0; attempt < 500; ++attempt) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0) {
+            return fd;
+        }
+        close(fd);
+        usleep(10000);
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// - writes the whole stream while reading answers, so neither side
+//   blocks on a full buffer
+// - returns the number of answer lines
+//----------------------------------------------------------------------
+uint64_t pumpStream(int fd, const string& stream) {
+    size_t sent = 0;
+    uint64_t answers = 0;
+    char buf[65536];
+
+    while (true) {
+        pollfd p = { fd, POLLIN, 0 };
+        if (sent < stream.size()) {
+            p.events |= POLLOUT;
+        }
+        if (poll(&p, 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (p.revents & POLLOUT) {
+            ssize_t n = write(fd, stream.data() + sent, stream.size() - sent);
+            if (n > 0) {
+                sent += n;
+                if (sent == stream.size()) {
+                    shutdown(fd, SHUT_WR);
+                }
+            }
+        }
+        if (p.revents & (POLLIN | POLLHUP)) {
+            ssize_t n = read(fd, buf, sizeof buf);
+            if (n <= 0) {
+                break;
+            }
+            answers += std::count(buf, buf + n, '\n');
+        }
+    }
+    return answers;
+}
+
+//----------------------------------------------------------------------
+// - sends single lines and waits for each answer
+//----------------------------------------------------------------------
+void pingPong(int fd, const string& stream, vector<uint64_t>& latencyNs) {
+    size_t pos = 0;
+    char buf[4096];
+
+    while (latencyNs.size() < LATENCY_SAMPLES && pos < stream.size()) {
+        size_t nl = stream.find('\n', pos);
+        if (nl == string::npos) {
+            break;
+        }
+
+        Clock::time_point start = Clock::now();
+        if (write(fd, stream.data() + pos, nl + 1 - pos) <= 0) {
+            return;
+        }
+        pos = nl + 1;
+
+        ssize_t n;
+        do {
+            n = read(fd, buf, sizeof buf);
+        } while (n > 0 && buf[n - 1] != '\n');
+        if (n <= 0) {
+            return;
+        }
+        latencyNs.push_back(elapsedNs(start));
+    }
+}
+
+//----------------------------------------------------------------------
+// - forks a server, measures throughput and round trips, then stops
+//   it and charges its CPU time to this mode
+//----------------------------------------------------------------------
+void runSocket(const string& stream, ModeResult& r) {
+    string path = "/tmp/cmd_harness_" + std::to_string(getpid()) + ".sock";
+
+    fflush(nullptr);
+    pid_t child = fork();
+    if (child < 0) {
+        return;
+    }
+    if (child == 0) {
+        freopen(NULL_DEVICE, "w", stderr);
+        char* args[] = { const_cast<char*>(path.c_str()) };
+        _exit(serverMain(1, args));
+    }
+
+    int fd = connectTo(path);
+    if (fd >= 0) {
+        Clock::time_point start = Clock::now();
+        uint64_t answers = pumpStream(fd, stream);
+        r.wallSec = elapsedNs(start) / 1e9;
+        close(fd);
+        r.ran = answers == r.lines;
+    }
+
+    fd = connectTo(path);
+    if (fd >= 0) {
+        pingPong(fd, stream, r.latencyNs);
+        close(fd);
+    }
+
+    kill(child, SIGTERM);
+    int status;
+    rusage usage;
+    if (wait4(child, &status, 0, &usage) == child) {
+        r.cpuSec = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+            + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+        // the round-trip lines were validated too
+        r.lines += r.latencyNs.size();
+    }
+}
+#endif
+
+void printResult(ModeResult& r) {
+    char line[160];
+    if (!r.ran) {
+        snprintf(line, sizeof line, "  %-12s %s\n", r.mode, "not run");
+        cout << line;
+        return;
+    }
+
+    double lps = r.wallSec > 0 ? r.lines / r.wallSec : 0;
+    double cpuNs = r.lines ? r.cpuSec * 1e9 / r.lines : 0;
+
+    if (r.latencyNs.empty()) {
+        snprintf(line, sizeof line, "  %-12s %14.0f %14.1f %10s %10s %10s\n",
+            r.mode, lps, cpuNs, "-", "-", "-");
+    }
+    else {
+        snprintf(line, sizeof line,
+            "  %-12s %14.0f %14.1f %10.2f %10.2f %10.2f\n",
+            r.mode, lps, cpuNs,
+            percentile(r.latencyNs, 0.50) / 1000.0,
+            percentile(r.latencyNs, 0.99) / 1000.0,
+            percentile(r.latencyNs, 0.999) / 1000.0);
+    }
+    cout << line;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+uint64_t percentile(vector<uint64_t>& samples, double p) {
+    if (samples.empty()) {
+        return 0;
+    }
+
+    size_t at = static_cast<size_t>(p * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + at, samples.end());
+    return samples[at];
+}
+
+//------------------------------------------------------------------------------
+// - entry point for --harness
+//------------------------------------------------------------------------------
+int harnessMain(int argc, char* argv[]) {
+    GenOptions opt;
+    opt.lines = 200000;
+    string modes = "interactive,batch,mmap,socket";
+
+    for (int i = 0; i < argc; ++i) {
+        if (!strcmp(argv[i], "--modes") && i + 1 < argc) {
+            modes = argv[++i];
+        }
+        else if (!parseGenOption(argc, argv, i, opt)) {
+            cerr << "Usage: --harness [--modes interactive,batch,mmap,socket]"
+                " [generator options, see --generate]\n";
+            return 2;
+        }
+    }
+
+    // a quit would end the interactive loop and the socket connection
+    opt.quit = false;
+    opt.rate = 0;
+
+    string stream;
+    LoadGenerator gen(opt);
+    for (uint64_t n = 0; n < opt.lines; ++n) {
+        gen.next(stream);
+    }
+
+    FILE* file = std::tmpfile();
+    if (!file || fwrite(stream.data(), 1, stream.size(), file) != stream.size()
+        || fflush(file) != 0) {
+        cerr << "Cannot write the generated stream\n";
+        return 1;
+    }
+
+    cout << opt.lines << " lines, " << stream.size() << " bytes\n";
+    cout << "  mode               lines/s    cpu ns/line    p50 us"
+        "     p99 us   p99.9 us\n";
+
+    std::stringstream list(modes);
+    string mode;
+    int result = 0;
+    while (getline(list, mode, ',')) {
+        ModeResult r;
+        r.lines = opt.lines;
+
+        if (mode == "interactive") {
+            r.mode = "interactive";
+            runInteractive(stream, r);
+        }
+        else if (mode == "batch") {
+            r.mode = "batch";
+            runFilter(file, false, r);
+        }
+        else if (mode == "mmap") {
+            r.mode = "mmap";
+            runFilter(file, true, r);
+        }
+        else if (mode == "socket") {
+            r.mode = "socket";
+#ifndef _WIN32
+            runSocket(stream, r);
+#endif
+        }
+        else {
+            cerr << "Unknown mode " << mode << '\n';
+            result = 2;
+            continue;
+        }
+
+        printResult(r);
+    }
+
+    fclose(file);
+    return result;
+}
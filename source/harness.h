@@ -0,0 +1,34 @@
+//----------------------------------------------------------------------
+// harness.h
+//
+// End-to-end throughput harness: feeds one generated stream through
+// each input mode of the validator and reports lines/sec, CPU time
+// per line and per-line latency percentiles.
+//----------------------------------------------------------------------
+#pragma once
+
+#include <cstdint>
+#include <streambuf>
+#include <vector>
+
+//----------------------------------------------------------------------
+// NullBuffer : a streambuf that drops everything written to it
+//----------------------------------------------------------------------
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override {
+        return n;
+    }
+};
+
+//----------------------------------------------------------------------
+// - returns the p-th percentile (0..1) of the samples, sorting them
+// - returns 0 for no samples
+//----------------------------------------------------------------------
+uint64_t percentile(std::vector<uint64_t>& samples, double p);
+
+//----------------------------------------------------------------------
+// - entry point for --harness [--modes list] [generator options]
+//----------------------------------------------------------------------
+int harnessMain(int argc, char* argv[]);
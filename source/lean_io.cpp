@@ -0,0 +1,306 @@
+//----------------------------------------------------------------------
+// lean_io.cpp
+//
+// The interactive loop without iostreams.
+//----------------------------------------------------------------------
+#include "lean_io.h"
+#include "cmd_validate.h"
+#include "alloc_stats.h"
+#include "engines.h"
+#include "line_reader.h"
+#include "normalize.h"
+#include "sketches.h"
+
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::string;
+using std::vector;
+
+namespace {
+
+constexpr size_t IO_BLOCK = 1 << 16;
+
+const char WELCOME[] = "Welcome to the Command Validator!\n\n";
+const char PROMPT[] =
+    "P)lay, pA)use, R)ewind, F)ast-forward, S)top, or Q)uit?: ";
+const char GOODBYE[] = "\nGoodbye!\n\n";
+
+#ifdef _WIN32
+int readFd(int fd, char* buf, size_t size) {
+    return _read(fd, buf, static_cast<unsigned>(size));
+}
+int writeFd(int fd, const char* buf, size_t size) {
+    return _write(fd, buf, static_cast<unsigned>(size));
+}
+#else
+ssize_t readFd(int fd, char* buf, size_t size) {
+    return read(fd, buf, size);
+}
+ssize_t writeFd(int fd, const char* buf, size_t size) {
+    return write(fd, buf, size);
+}
+#endif
+
+//----------------------------------------------------------------------
+// RawOutput : buffered write() to one descriptor
+//----------------------------------------------------------------------
+class RawOutput {
+public:
+    explicit RawOutput(int fd) : fd(fd) { buf.reserve(IO_BLOCK); }
+    ~RawOutput() { flush(); }
+
+    void put(const char* data, size_t len) {
+        if (buf.size() + len > IO_BLOCK) {
+            flush();
+        }
+        buf.insert(buf.end(), data, data + len);
+    }
+    void put(const char* str) { put(str, strlen(str)); }
+
+    void flush() {
+        size_t done = 0;
+        while (done < buf.size()) {
+            auto n = writeFd(fd, buf.data() + done, buf.size() - done);
+            if (n <= 0) {
+                break;
+            }
+            done += static_cast<size_t>(n);
+        }
+        buf.clear();
+    }
+
+private:
+    int fd;
+    vector<char> buf;
+};
+
+//----------------------------------------------------------------------
+// RawInput : lines from read() on one descriptor, no longer than
+// maxLine(), handed out as pointers into the buffer
+//----------------------------------------------------------------------
+class RawInput {
+public:
+    // - called before a read() that may block
+    using BeforeRead = void (*)(void* context);
+
+    RawInput(int fd, BeforeRead beforeRead, void* context)
+        : fd(fd), maxLen(maxLine()), beforeRead(beforeRead),
+        context(context), buf(maxLen + 1 > IO_BLOCK ? maxLen + 1 : IO_BLOCK) {}
+
+    // - points line/len at the next line, valid until the next call
+    // - returns the same results as LineReader::next()
+    LineReader::Result next(char*& line, size_t& len);
+
+private:
+    int fd;
+    size_t maxLen;
+    BeforeRead beforeRead;
+    void* context;
+    vector<char> buf;
+    size_t begin = 0;               // first unconsumed byte
+    size_t end = 0;                 // one past the last byte read
+    bool atEof = false;
+    bool skipping = false;          // rest of a too-long line pending
+
+    bool fill();
+    void skipLine();
+};
+
+//------------------------------------------------------------------------------
+// - moves the unconsumed bytes to the front and reads more after them
+// - returns false at the end of the input
+//------------------------------------------------------------------------------
+bool RawInput::fill() {
+    if (atEof) {
+        return false;
+    }
+    memmove(buf.data(), buf.data() + begin, end - begin);
+    end -= begin;
+    begin = 0;
+
+    beforeRead(context);
+    auto n = readFd(fd, buf.data() + end, buf.size() - end);
+    if (n <= 0) {
+        atEof = true;
+        return false;
+    }
+    end += static_cast<size_t>(n);
+    return true;
+}
+
+void RawInput::skipLine() {
+    while (true) {
+        const char* nl = static_cast<const char*>(
+            memchr(buf.data() + begin, '\n', end - begin));
+        if (nl) {
+            begin = nl + 1 - buf.data();
+            return;
+        }
+        begin = end;
+        if (!fill()) {
+            return;
+        }
+    }
+}
+
+LineReader::Result RawInput::next(char*& line, size_t& len) {
+    // skipped only now, so the preview stayed valid until this call
+    if (skipping) {
+        skipLine();
+        skipping = false;
+    }
+
+    size_t scanned = begin;
+    while (true) {
+        char* nl = static_cast<char*>(
+            memchr(buf.data() + scanned, '\n', end - scanned));
+
+        if (nl) {
+            line = buf.data() + begin;
+            len = nl - line;
+            begin = nl + 1 - buf.data();
+            if (len > maxLen) {
+                len = maxLen;
+                return LineReader::LINE_TOO_LONG;
+            }
+            return LineReader::LINE;
+        }
+
+        if (end - begin > maxLen) {
+            line = buf.data() + begin;
+            len = maxLen;
+            begin += maxLen;
+            skipping = true;
+            return LineReader::LINE_TOO_LONG;
+        }
+
+        scanned = end;
+        size_t offset = scanned - begin;
+        if (!fill()) {
+            // an unterminated last line
+            if (end == begin) {
+                return LineReader::END;
+            }
+            line = buf.data() + begin;
+            len = end - begin;
+            begin = end;
+            return LineReader::LINE;
+        }
+        scanned = begin + offset;
+    }
+}
+
+void flushOutput(void* context) {
+    static_cast<RawOutput*>(context)->flush();
+}
+
+//----------------------------------------------------------------------
+// - what the interactive loop prints for an empty line comes from the
+//   standard library's out_of_range text, so take it from there once
+//----------------------------------------------------------------------
+const string& emptyLineMessage() {
+    static const string message = [] {
+        try {
+            matchCommand(string());
+        }
+        catch (std::exception& e) {
+            return string(e.what());
+        }
+        return string();
+    }();
+    return message;
+}
+
+//----------------------------------------------------------------------
+// - an unrecognized command is caught as std::exception, whose what()
+//   text differs between standard libraries, followed by a space
+//----------------------------------------------------------------------
+const string& unrecognizedPrefix() {
+    static const string prefix = string(std::exception().what()) + ' ';
+    return prefix;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// - entry point for --lean
+//------------------------------------------------------------------------------
+int leanMain(int, char*[]) {
+    RawOutput out(1);
+    RawInput in(0, flushOutput, &out);
+
+    out.put(WELCOME);
+
+    while (true) {
+        out.put(PROMPT);
+
+        char* line;
+        size_t len;
+        LineReader::Result got = in.next(line, len);
+        if (got == LineReader::END) {
+            break;
+        }
+        ALLOC_COUNT_COMMANDS(1);
+
+        if (got == LineReader::LINE_TOO_LONG) {
+            len = len < TOO_LONG_PREVIEW ? len : TOO_LONG_PREVIEW;
+            if (sketchesEnabled()) {
+                rejectSketches().add(line, len);
+            }
+            out.put("Line too long: ");
+            out.put(line, len);
+            out.put("...\n\n");
+            continue;
+        }
+
+        if (normalizeOn()) {
+            len = normalizeLine(line, len);
+        }
+
+        Command cmd = classifyLine(line, len);
+        if (isAccepted(cmd)) {
+            out.put(commandName(cmd));
+            if (cmd == CMD_QUIT) {
+                out.put("\n");
+                out.put(GOODBYE);
+                return 0;
+            }
+            out.put("\n\n");
+            continue;
+        }
+
+        if (sketchesEnabled()) {
+            rejectSketches().add(line, len);
+        }
+        if (len == 0) {
+            out.put(emptyLineMessage().data(), emptyLineMessage().size());
+            out.put(" \n\n");
+        }
+        else {
+            // the interactive loop prints the base class what() here
+            if (cmd == CMD_BAD_STRING) {
+                out.put("Bad string: ");
+            }
+            else {
+                out.put(unrecognizedPrefix().data(),
+                    unrecognizedPrefix().size());
+            }
+            out.put(line, len);
+            out.put("\n\n");
+        }
+    }
+
+    return 0;
+}
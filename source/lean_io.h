@@ -0,0 +1,22 @@
+//----------------------------------------------------------------------
+// lean_io.h
+//
+// Lean mode: the interactive loop on raw read()/write() with our own
+// buffers, for short-lived processes started from scripts.
+//
+// The output is the same, byte for byte, as the interactive loop in
+// main() gives for the same input. Lines are classified in place with
+// the selected engine (see engines.h) and never copied into strings,
+// and nothing is thrown.
+//
+// Output is written when the input buffer runs dry, so a terminal
+// still sees each prompt before we wait for the next line, while a
+// piped script gets one write() per read().
+//----------------------------------------------------------------------
+#pragma once
+
+//----------------------------------------------------------------------
+// - entry point for --lean
+// - returns the process exit code
+//----------------------------------------------------------------------
+int leanMain(int argc, char* argv[]);
@@ -0,0 +1,404 @@
+//----------------------------------------------------------------------
+// line_filter.cpp
+//
+// Filter mode writes every input line to one of two outputs, in its
+// original form, depending on whether the validator accepts it.
+//
+// The lines are never copied into strings. We classify each line in
+// place and hand the raw byte ranges to the output, merging runs of
+// neighbouring lines that go to the same output into one range.
+//
+// Line ends come from a LineIndex built over up to INDEX_WINDOW bytes
+// at a time, so the classify loop walks precomputed offsets rather
+// than searching for each newline.
+//
+// On POSIX a regular input file is mmap'd and the ranges are written
+// with gathered writev() calls. Pipes and terminals are read in large
+// blocks. On Windows the same ranges are written with fwrite().
+//
+// A line over the --max-line limit goes to the rejected output without
+// being classified. When reading blocks, such a line is passed through
+// as it arrives, so the buffer never grows past one block.
+//
+// splice() is not used: it moves bytes without letting us look at
+// them, and we have to look at every line to classify it.
+//----------------------------------------------------------------------
+#include "line_filter.h"
+#include "cmd_validate.h"
+#include "engines.h"
+#include "alloc_stats.h"
+#include "line_index.h"
+#include "line_reader.h"
+#include "normalize.h"
+#include "sketches.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifndef _WIN32
+#include <climits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::vector;
+
+namespace {
+
+// block size for non-mmap input
+constexpr size_t READ_BLOCK = 1 << 20;
+
+#ifndef _WIN32
+// most iovecs handed to one writev() call
+#ifdef IOV_MAX
+constexpr int MAX_IOV = IOV_MAX < 1024 ? IOV_MAX : 1024;
+#else
+constexpr int MAX_IOV = 1024;
+#endif
+#endif
+
+//----------------------------------------------------------------------
+// RawSink : collects byte ranges for one output and writes them out
+// in gathered batches
+//----------------------------------------------------------------------
+class RawSink {
+public:
+    RawSink(FILE* file) : file(file) {}
+
+    // - queues [data, data + len) for writing
+    // - merges with the previous range when they touch in memory
+    void add(const char* data, size_t len) {
+        if (!pending.empty()) {
+            Range& last = pending.back();
+            if (last.data + last.len == data) {
+                last.len += len;
+                return;
+            }
+        }
+        pending.push_back({ data, len });
+#ifndef _WIN32
+        if (pending.size() >= MAX_IOV) {
+            flush();
+        }
+#endif
+    }
+
+    // - writes all queued ranges
+    // - must be called before the memory behind them is reused
+    // - returns false on write error
+    bool flush();
+
+private:
+    struct Range {
+        const char* data;
+        size_t len;
+    };
+
+    FILE* file;
+    vector<Range> pending;
+    bool failed = false;
+};
+
+#ifndef _WIN32
+//----------------------------------------------------------------------
+// - hands the queued ranges to writev() in batches of MAX_IOV,
+//   restarting after short writes
+//----------------------------------------------------------------------
+bool RawSink::flush() {
+    int fd = fileno(file);
+    size_t first = 0;
+
+    while (first < pending.size() && !failed) {
+        iovec iov[MAX_IOV];
+        int count = 0;
+        for (size_t i = first; i < pending.size() && count < MAX_IOV; ++i) {
+            iov[count].iov_base = const_cast<char*>(pending[i].data);
+            iov[count].iov_len = pending[i].len;
+            ++count;
+        }
+
+        ssize_t written = writev(fd, iov, count);
+        if (written < 0) {
+            failed = true;
+            break;
+        }
+
+        // drop fully written ranges, trim a partly written one
+        size_t left = static_cast<size_t>(written);
+        while (first < pending.size() && left >= pending[first].len) {
+            left -= pending[first].len;
+            ++first;
+        }
+        if (left > 0) {
+            pending[first].data += left;
+            pending[first].len -= left;
+        }
+    }
+
+    pending.clear();
+    return !failed;
+}
+#else
+//----------------------------------------------------------------------
+// - writes the queued ranges one after another
+//----------------------------------------------------------------------
+bool RawSink::flush() {
+    for (const Range& r : pending) {
+        if (!failed && fwrite(r.data, 1, r.len, file) != r.len) {
+            failed = true;
+        }
+    }
+    fflush(file);
+
+    pending.clear();
+    return !failed;
+}
+#endif
+
+//----------------------------------------------------------------------
+// - queues a line over the length limit as rejected, unclassified
+//----------------------------------------------------------------------
+void rejectTooLong(const char* line, size_t len, RawSink& rejected,
+    FilterCounts& counts) {
+
+    rejected.add(line, len);
+    if (sketchesEnabled()) {
+        rejectSketches().add(line,
+            len < TOO_LONG_PREVIEW ? len : TOO_LONG_PREVIEW);
+    }
+    ++counts.rejected;
+}
+
+//----------------------------------------------------------------------
+// - classifies one line and queues it, with its newline if any
+// - with --normalize only the classified view is trimmed, the line
+//   is still written out as it was read
+//----------------------------------------------------------------------
+void filterLine(const char* line, const char* lineEnd, const char* next,
+    size_t limit, RawSink& accepted, RawSink& rejected,
+    FilterCounts& counts) {
+
+    const char* view = line;
+    size_t len = lineEnd - line;
+    if (len > limit) {
+        ALLOC_COUNT_COMMANDS(1);
+        rejectTooLong(line, next - line, rejected, counts);
+        return;
+    }
+    if (normalizeOn()) {
+        trimLine(view, len);
+    }
+
+    ALLOC_COUNT_COMMANDS(1);
+    if (isAccepted(classifyLine(view, len))) {
+        accepted.add(line, next - line);
+        ++counts.accepted;
+    }
+    else {
+        rejected.add(line, next - line);
+        if (sketchesEnabled()) {
+            rejectSketches().add(line, lineEnd - line);
+        }
+        ++counts.rejected;
+    }
+}
+
+//----------------------------------------------------------------------
+// - classifies every complete line in [begin, end) and queues it on
+//   the matching sink, newline included
+// - returns a pointer to the first byte of an unfinished last line,
+//   or end if the block ended on a newline
+// - with atEof set the unfinished last line is processed too
+//----------------------------------------------------------------------
+const char* filterBlock(const char* begin, const char* end, bool atEof,
+    RawSink& accepted, RawSink& rejected, FilterCounts& counts) {
+
+    // reused, so its offsets are allocated once
+    static LineIndex index;
+    const size_t limit = maxLine();
+
+    const char* line = begin;
+    for (const char* window = begin; window < end; window += INDEX_WINDOW) {
+        size_t len = static_cast<size_t>(end - window);
+        index.build(window, len < INDEX_WINDOW ? len : INDEX_WINDOW);
+
+        for (uint32_t offset : index) {
+            const char* nl = window + offset;
+            filterLine(line, nl, nl + 1, limit, accepted, rejected, counts);
+            line = nl + 1;
+        }
+    }
+
+    if (atEof && line < end) {
+        filterLine(line, end, end, limit, accepted, rejected, counts);
+        line = end;
+    }
+    return line;
+}
+
+//----------------------------------------------------------------------
+// - reads the input in blocks, carrying an unfinished line over to
+//   the front of the next block
+// - an unfinished line that fills the whole block is over the limit:
+//   it is rejected and the rest of it copied through as it arrives
+// - returns false on error
+//----------------------------------------------------------------------
+bool filterStream(FILE* in, RawSink& accepted, RawSink& rejected,
+    FilterCounts& counts) {
+
+    size_t limit = maxLine();
+    vector<char> buf(limit < READ_BLOCK ? READ_BLOCK : limit + 1);
+    size_t used = 0;
+    bool passing = false;           // inside a too-long line
+
+    while (true) {
+        size_t got = fread(buf.data() + used, 1, buf.size() - used, in);
+        bool atEof = got == 0;
+        used += got;
+
+        const char* begin = buf.data();
+        const char* from = begin;
+        if (passing) {
+            const void* nl = memchr(begin, '\n', used);
+            from = nl ? static_cast<const char*>(nl) + 1 : begin + used;
+            rejected.add(begin, from - begin);
+            passing = !nl;
+        }
+
+        const char* rest = filterBlock(from, begin + used, atEof,
+            accepted, rejected, counts);
+
+        size_t tail = begin + used - rest;
+        if (tail == buf.size()) {
+            rejectTooLong(rest, tail, rejected, counts);
+            passing = true;
+            tail = 0;
+        }
+
+        // the ranges point into buf, so write them before it is reused
+        if (!accepted.flush() || !rejected.flush()) {
+            return false;
+        }
+
+        memmove(buf.data(), rest, tail);
+        used = tail;
+
+        if (atEof) {
+            return !ferror(in);
+        }
+    }
+}
+
+#ifndef _WIN32
+//----------------------------------------------------------------------
+// - filters a regular file through a read-only mapping
+// - returns 1 if the file was filtered, 0 if it cannot be mapped and
+//   should be streamed instead, -1 on error
+//----------------------------------------------------------------------
+int filterMapped(FILE* in, RawSink& accepted, RawSink& rejected,
+    FilterCounts& counts) {
+
+    int fd = fileno(in);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        return 0;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        return 0;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    const char* begin = static_cast<const char*>(map);
+    filterBlock(begin, begin + size, true, accepted, rejected, counts);
+    bool ok = accepted.flush() && rejected.flush();
+
+    munmap(map, size);
+    return ok ? 1 : -1;
+}
+#endif
+
+//----------------------------------------------------------------------
+// - opens a named file, "-" meaning the passed standard stream
+// - returns nullptr and prints a message on failure
+//----------------------------------------------------------------------
+FILE* openArg(const char* name, const char* mode, FILE* standard) {
+    if (!strcmp(name, "-")) {
+        return standard;
+    }
+
+    FILE* f = fopen(name, mode);
+    if (!f) {
+        fprintf(stderr, "Cannot open %s\n", name);
+    }
+    return f;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// - filters one input into the two outputs
+//------------------------------------------------------------------------------
+bool filterLines(FILE* in, FILE* acceptedFile, FILE* rejectedFile,
+    bool useMmap, FilterCounts& counts) {
+
+    RawSink accepted(acceptedFile);
+    RawSink rejected(rejectedFile);
+
+    int result = 0;
+#ifndef _WIN32
+    if (useMmap) {
+        result = filterMapped(in, accepted, rejected, counts);
+    }
+#endif
+    if (result == 0) {
+        result = filterStream(in, accepted, rejected, counts) ? 1 : -1;
+    }
+    return result > 0;
+}
+
+//------------------------------------------------------------------------------
+// - entry point for --filter
+//------------------------------------------------------------------------------
+int filterMain(int argc, char* argv[]) {
+    bool useMmap = true;
+    if (argc > 0 && !strcmp(argv[0], "--no-mmap")) {
+        useMmap = false;
+        --argc;
+        ++argv;
+    }
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: --filter [--no-mmap] <accepted-out>"
+            " <rejected-out> [input]\n");
+        return 2;
+    }
+
+    FILE* acceptedFile = openArg(argv[0], "wb", stdout);
+    FILE* rejectedFile = openArg(argv[1], "wb", stdout);
+    FILE* in = openArg(argc == 3 ? argv[2] : "-", "rb", stdin);
+    if (!acceptedFile || !rejectedFile || !in) {
+        return 1;
+    }
+
+    FilterCounts counts;
+    bool ok = filterLines(in, acceptedFile, rejectedFile, useMmap, counts);
+
+    fprintf(stderr, "accepted %zu, rejected %zu\n",
+        counts.accepted, counts.rejected);
+
+    if (!ok) {
+        fprintf(stderr, "Filter failed\n");
+        return 1;
+    }
+    return 0;
+}
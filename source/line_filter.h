@@ -0,0 +1,35 @@
+//----------------------------------------------------------------------
+// line_filter.h
+//
+// Filter mode: splits an input stream into accepted and rejected
+// lines, each written out exactly as it was read.
+//----------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+
+//----------------------------------------------------------------------
+// FilterCounts : lines sent to each output
+//----------------------------------------------------------------------
+struct FilterCounts {
+    size_t accepted = 0;
+    size_t rejected = 0;
+};
+
+//----------------------------------------------------------------------
+// - copies each line of `in` to `accepted` or `rejected`, unchanged
+// - a regular input file is mmap'd unless useMmap is false
+// - returns false on read or write error
+//----------------------------------------------------------------------
+bool filterLines(FILE* in, FILE* accepted, FILE* rejected, bool useMmap,
+    FilterCounts& counts);
+
+//----------------------------------------------------------------------
+// - runs filter mode from the command line arguments that follow
+//   --filter:  [--no-mmap] <accepted-out> <rejected-out> [input]
+// - "-" names stdin/stdout, a missing input means stdin
+// - --no-mmap reads a regular file in blocks instead of mapping it
+// - returns the process exit code
+//----------------------------------------------------------------------
+int filterMain(int argc, char* argv[]);
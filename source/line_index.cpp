@@ -0,0 +1,154 @@
+//----------------------------------------------------------------------
+// line_index.cpp
+//
+// With SSE2, 32 bytes per step: two compares against '\n' give a
+// 32-bit mask, and each set bit becomes one offset, lowest first.
+//
+// Without SSE2 the same index is built a byte at a time.
+//----------------------------------------------------------------------
+#include "line_index.h"
+
+#include <bit>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CMD_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// the SSE2 loop adds at most this many offsets per step
+constexpr size_t STEP = 32;
+
+} // namespace
+
+void LineIndex::build(const char* data, size_t len) {
+    count = 0;
+
+    if (offsets.empty()) {
+        offsets.resize(STEP * 64);
+    }
+
+    size_t i = 0;
+
+#ifdef CMD_HAVE_SSE2
+    const __m128i nl = _mm_set1_epi8('\n');
+
+    for (; i + STEP <= len; i += STEP) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i b = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(data + i + 16));
+
+        uint32_t mask = static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(a, nl)))
+            | static_cast<uint32_t>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(b, nl))) << 16;
+
+        if (!mask) {
+            continue;
+        }
+        if (offsets.size() < count + STEP) {
+            offsets.resize(offsets.size() * 2);
+        }
+
+        uint32_t* out = offsets.data() + count;
+        count += std::popcount(mask);
+        do {
+            *out++ = static_cast<uint32_t>(i + std::countr_zero(mask));
+            mask &= mask - 1;
+        } while (mask);
+    }
+#endif
+
+    for (; i < len; ++i) {
+        if (data[i] == '\n') {
+            if (offsets.size() == count) {
+                offsets.resize(offsets.size() * 2);
+            }
+            offsets[count++] = static_cast<uint32_t>(i);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// BlockLineReader
+//------------------------------------------------------------------------------
+BlockLineReader::BlockLineReader(FILE* in, size_t limit)
+    : in(in), maxLen(limit ? limit : DEFAULT_MAX_LINE),
+      buf(maxLen + INDEX_WINDOW) {}
+
+LineReader::Result BlockLineReader::next(char*& line, size_t& len) {
+    while (true) {
+        if (taken < index.size()) {
+            size_t nl = indexBase + index.begin()[taken++];
+            size_t start = pos;
+            pos = nl + 1;
+            if (skipping) {
+                skipping = false;
+                continue;
+            }
+
+            line = buf.data() + start;
+            len = nl - start;
+            if (len > maxLen) {
+                len = maxLen;
+                return LineReader::LINE_TOO_LONG;
+            }
+            return LineReader::LINE;
+        }
+
+        // no newline in what is buffered: the rest of a long line is
+        // dropped, and an unfinished line past the limit answered now
+        if (skipping) {
+            pos = used;
+        }
+        else if (used - pos > maxLen) {
+            line = buf.data() + pos;
+            len = maxLen;
+            pos = used;
+            skipping = true;
+            return LineReader::LINE_TOO_LONG;
+        }
+
+        if (!fill()) {
+            // an unfinished last line is still a line
+            if (pos == used) {
+                return LineReader::END;
+            }
+            line = buf.data() + pos;
+            len = used - pos;
+            pos = used;
+            return LineReader::LINE;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// - moves the unfinished line to the front, reads one block after it
+//   and indexes the block
+// - the unfinished line is at most maxLen bytes, so a whole block fits
+// - returns false at the end of the input
+//------------------------------------------------------------------------------
+bool BlockLineReader::fill() {
+    if (eof) {
+        return false;
+    }
+
+    used -= pos;
+    memmove(buf.data(), buf.data() + pos, used);
+    pos = 0;
+
+    size_t got = fread(buf.data() + used, 1, INDEX_WINDOW, in);
+    if (got == 0) {
+        eof = true;
+        return false;
+    }
+
+    index.build(buf.data() + used, got);
+    indexBase = used;
+    taken = 0;
+    used += got;
+    return true;
+}
@@ -0,0 +1,74 @@
+//----------------------------------------------------------------------
+// line_index.h
+//
+// Newline index for a block of input, built in one vectorized pass,
+// like the structural index of simdjson: first find every line end,
+// then let the validation loop walk the precomputed offsets instead
+// of searching for the next newline line by line.
+//
+// Only '\n' is indexed. A CR before it stays part of the line, as it
+// does with getline(); --normalize is what treats it as a blank, in
+// every mode, see normalize.h.
+//----------------------------------------------------------------------
+#pragma once
+
+#include "line_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// most bytes indexed at once, so offsets fit in 32 bits and the index
+// stays in cache
+constexpr size_t INDEX_WINDOW = size_t(1) << 20;
+
+//----------------------------------------------------------------------
+// LineIndex : newline offsets of one window
+//----------------------------------------------------------------------
+class LineIndex {
+public:
+    // - indexes [data, data + len), len at most INDEX_WINDOW
+    void build(const char* data, size_t len);
+
+    // offsets of the '\n' bytes from the start of the window, ascending
+    const uint32_t* begin() const { return offsets.data(); }
+    const uint32_t* end() const { return offsets.data() + count; }
+    size_t size() const { return count; }
+
+private:
+    std::vector<uint32_t> offsets;  // grows, never shrinks
+    size_t count = 0;
+};
+
+//----------------------------------------------------------------------
+// BlockLineReader : LineReader for the bulk modes, over a FILE*
+// - reads blocks of up to INDEX_WINDOW bytes and takes the lines from
+//   a LineIndex of each block, instead of one getline() per line
+// - the lines stay in its buffer, nothing is copied into strings
+// - the buffer holds one block plus one unfinished line, so memory
+//   stays bounded by maxLen like LineReader's
+//----------------------------------------------------------------------
+class BlockLineReader {
+public:
+    explicit BlockLineReader(FILE* in, size_t maxLen = maxLine());
+
+    // - the next line without its newline, in place and writable, so
+    //   normalizeLine() can run on it; valid until the next call
+    // - for LINE_TOO_LONG, the first maxLen bytes, the rest is skipped
+    LineReader::Result next(char*& line, size_t& len);
+
+private:
+    FILE* in;
+    size_t maxLen;
+    std::vector<char> buf;          // maxLen + INDEX_WINDOW, never grows
+    size_t pos = 0;                 // start of the next line in buf
+    size_t used = 0;                // bytes in buf
+    LineIndex index;                // of the last block read
+    size_t indexBase = 0;           // where that block starts in buf
+    size_t taken = 0;               // offsets of it already used
+    bool eof = false;
+    bool skipping = false;          // dropping the rest of a long line
+
+    bool fill();
+};
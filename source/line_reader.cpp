@@ -0,0 +1,61 @@
+//----------------------------------------------------------------------
+// line_reader.cpp
+//
+// Bounded line input on top of istream::getline(char*, n), which
+// stores at most n - 1 bytes and sets failbit when a line is longer.
+//----------------------------------------------------------------------
+#include "line_reader.h"
+
+#include <limits>
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::istream;
+using std::string;
+
+namespace {
+
+size_t maxLineLength = DEFAULT_MAX_LINE;
+
+} // namespace
+
+void setMaxLine(size_t maxLen) {
+    maxLineLength = maxLen ? maxLen : DEFAULT_MAX_LINE;
+}
+
+size_t maxLine() {
+    return maxLineLength;
+}
+
+LineReader::LineReader(istream& in, size_t maxLen)
+    : in(in), buf((maxLen ? maxLen : DEFAULT_MAX_LINE) + 1) {}
+
+//------------------------------------------------------------------------------
+// - a line of exactly maxLen bytes still fits: getline() takes the
+//   newline that follows without setting failbit
+//------------------------------------------------------------------------------
+LineReader::Result LineReader::next(string& line) {
+    in.getline(buf.data(), static_cast<std::streamsize>(buf.size()));
+    size_t got = static_cast<size_t>(in.gcount());
+
+    if (!in.fail()) {
+        // gcount() includes the newline, unless the input ended first
+        if (got > 0 && !in.eof()) {
+            --got;
+        }
+        line.assign(buf.data(), got);
+        return LINE;
+    }
+
+    // nothing at all before the end of the input
+    if (got == 0) {
+        return END;
+    }
+
+    // stopped at the limit: drop the rest of the line unbuffered
+    line.assign(buf.data(), got);
+    in.clear();
+    in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    return LINE_TOO_LONG;
+}
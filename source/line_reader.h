@@ -0,0 +1,48 @@
+//----------------------------------------------------------------------
+// line_reader.h
+//
+// Line input with a fixed upper bound on memory.
+//
+// getline() grows its string to fit whatever arrives, so a single
+// line without a newline can make the process allocate gigabytes.
+// LineReader stops buffering at the configured limit, skips ahead to
+// the next newline and reports the line as too long instead.
+//----------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <vector>
+
+// longest line accepted unless --max-line says otherwise
+constexpr size_t DEFAULT_MAX_LINE = 4096;
+
+// bytes of a too-long line shown in its rejection message
+constexpr size_t TOO_LONG_PREVIEW = 32;
+
+// - sets the line length limit for every mode, 0 restores the default
+void setMaxLine(size_t maxLen);
+size_t maxLine();
+
+//----------------------------------------------------------------------
+// LineReader : getline() with a length limit
+//----------------------------------------------------------------------
+class LineReader {
+public:
+    enum Result {
+        LINE,                       // a complete line
+        LINE_TOO_LONG,              // over the limit, rest skipped
+        END                         // no more input
+    };
+
+    explicit LineReader(std::istream& in, size_t maxLen = maxLine());
+
+    // - reads the next line into `line`, without the newline
+    // - for LINE_TOO_LONG, `line` holds the first maxLen bytes
+    Result next(std::string& line);
+
+private:
+    std::istream& in;
+    std::vector<char> buf;          // maxLen + 1 bytes, never grows
+};
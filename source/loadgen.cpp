@@ -0,0 +1,223 @@
+//----------------------------------------------------------------------
+// loadgen.cpp
+//
+// Generates command streams with a configurable mix of valid and
+// invalid lines, case variations, abbreviations, bad characters,
+// lengths and sessions.
+//
+// Generation uses xorshift64* and appends into one large buffer, so
+// the generator can outrun the validator it feeds.
+//----------------------------------------------------------------------
+#include "loadgen.h"
+#include "envelope.h"
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::string;
+
+namespace {
+
+// bytes buffered before each write to stdout
+constexpr size_t WRITE_CHUNK = 1 << 16;
+
+const char* const COMMANDS[] = {
+    "play", "pause", "rewind", "fast-forward", "stop", "quit"
+};
+const char ABBREVIATIONS[] = "parfsq";
+
+// first letters that match no command
+const char UNKNOWN_FIRST[] = "bcdeghijklmnotuvwxyz";
+
+// bytes validateString() rejects
+const char BAD_BYTES[] = "0123456789 !.,_\t\r";
+
+// milliseconds between t= stamps without --rate
+constexpr uint64_t TICK_MS = 1;
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// - parses "--name value" generator options
+//------------------------------------------------------------------------------
+bool parseGenOption(int argc, char* argv[], int& i, GenOptions& opt) {
+    if (i + 1 >= argc) {
+        return false;
+    }
+
+    const char* name = argv[i];
+    const char* value = argv[i + 1];
+
+    if (!strcmp(name, "--lines")) {
+        opt.lines = strtoull(value, nullptr, 10);
+    }
+    else if (!strcmp(name, "--valid")) {
+        opt.validRatio = atof(value);
+    }
+    else if (!strcmp(name, "--mixed-case")) {
+        opt.caseRatio = atof(value);
+    }
+    else if (!strcmp(name, "--abbrev")) {
+        opt.abbrevRatio = atof(value);
+    }
+    else if (!strcmp(name, "--bad-chars")) {
+        opt.badCharRatio = atof(value);
+    }
+    else if (!strcmp(name, "--max-len")) {
+        opt.maxLen = static_cast<unsigned>(strtoul(value, nullptr, 10));
+    }
+    else if (!strcmp(name, "--sessions")) {
+        opt.sessions = strtoull(value, nullptr, 10);
+    }
+    else if (!strcmp(name, "--rate")) {
+        opt.rate = strtoull(value, nullptr, 10);
+    }
+    else if (!strcmp(name, "--time-base")) {
+        opt.timeBaseMs = strtoull(value, nullptr, 10);
+    }
+    else if (!strcmp(name, "--seed")) {
+        opt.seed = strtoull(value, nullptr, 10);
+    }
+    else if (!strcmp(name, "--quit")) {
+        opt.quit = atoi(value) != 0;
+    }
+    else {
+        return false;
+    }
+
+    ++i;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// LoadGenerator
+//------------------------------------------------------------------------------
+LoadGenerator::LoadGenerator(const GenOptions& opt)
+    : opt(opt), state(opt.seed ? opt.seed : 1),
+      timeBaseMs(opt.timeBaseMs ? opt.timeBaseMs : wallClockMs()) {
+}
+
+uint64_t LoadGenerator::random() {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ull;
+}
+
+double LoadGenerator::uniform() {
+    return (random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//------------------------------------------------------------------------------
+// - valid lines are a command or its letter, maybe in mixed case
+// - invalid lines are a command with a bad byte in it, or an unknown
+//   word made of letters only
+// - padding letters keep a line's class since the first letter decides
+//------------------------------------------------------------------------------
+void LoadGenerator::next(string& out) {
+    uint64_t n = produced++;
+
+    // t= is when a paced line is due, else one tick per line
+    if (opt.sessions) {
+        uint64_t offsetMs = opt.rate ? n * 1000 / opt.rate : n * TICK_MS;
+        out += "s=" + std::to_string(random() % opt.sessions)
+            + " n=" + std::to_string(n)
+            + " t=" + std::to_string(timeBaseMs + offsetMs) + ' ';
+    }
+
+    size_t start = out.size();
+    unsigned commandCount = opt.quit ? 6 : 5;
+    unsigned which = static_cast<unsigned>(random() % commandCount);
+
+    if (uniform() < opt.validRatio) {
+        if (uniform() < opt.abbrevRatio) {
+            out += ABBREVIATIONS[which];
+        }
+        else {
+            out += COMMANDS[which];
+        }
+
+        if (uniform() < opt.caseRatio) {
+            for (size_t i = start; i < out.size(); ++i) {
+                if (random() & 1) {
+                    out[i] = static_cast<char>(toupper(out[i]));
+                }
+            }
+        }
+    }
+    else if (uniform() < opt.badCharRatio) {
+        out += COMMANDS[which];
+        size_t len = out.size() - start;
+        size_t at = start + random() % (len + 1);
+        out.insert(out.begin() + at,
+            BAD_BYTES[random() % (sizeof BAD_BYTES - 1)]);
+    }
+    else {
+        out += UNKNOWN_FIRST[random() % (sizeof UNKNOWN_FIRST - 1)];
+        unsigned extra = 2 + random() % 8;
+        for (unsigned i = 0; i < extra; ++i) {
+            out += static_cast<char>('a' + random() % 26);
+        }
+    }
+
+    if (opt.maxLen > out.size() - start) {
+        size_t target = start + random() % (opt.maxLen + 1);
+        while (out.size() < target) {
+            out += static_cast<char>('a' + random() % 26);
+        }
+    }
+
+    out += '\n';
+}
+
+//------------------------------------------------------------------------------
+// - entry point for --generate
+//------------------------------------------------------------------------------
+int generateMain(int argc, char* argv[]) {
+    GenOptions opt;
+    for (int i = 0; i < argc; ++i) {
+        if (!parseGenOption(argc, argv, i, opt)) {
+            std::cerr << "Usage: --generate [--lines n] [--valid ratio]"
+                " [--mixed-case ratio] [--abbrev ratio] [--bad-chars ratio]"
+                " [--max-len n] [--sessions n] [--rate per-sec]"
+                " [--time-base ms] [--seed n] [--quit 0|1]\n";
+            return 2;
+        }
+    }
+
+    LoadGenerator gen(opt);
+    string buf;
+    buf.reserve(WRITE_CHUNK + 256);
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t n = 0; n < opt.lines; ++n) {
+        gen.next(buf);
+
+        // with pacing, flush each line when it is due
+        if (opt.rate) {
+            auto due = start + std::chrono::nanoseconds(
+                n * 1000000000ull / opt.rate);
+            std::this_thread::sleep_until(due);
+        }
+        if (opt.rate || buf.size() >= WRITE_CHUNK) {
+            if (fwrite(buf.data(), 1, buf.size(), stdout) != buf.size()) {
+                return 1;
+            }
+            buf.clear();
+            if (opt.rate) {
+                fflush(stdout);
+            }
+        }
+    }
+
+    fwrite(buf.data(), 1, buf.size(), stdout);
+    return fflush(stdout) == 0 ? 0 : 1;
+}
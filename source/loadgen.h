@@ -0,0 +1,58 @@
+//----------------------------------------------------------------------
+// loadgen.h
+//
+// Synthetic command streams for load tests.
+//----------------------------------------------------------------------
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+//----------------------------------------------------------------------
+// GenOptions : the mix of lines to generate
+//----------------------------------------------------------------------
+struct GenOptions {
+    uint64_t lines = 1000000;
+    double validRatio = 0.9;        // lines that should be accepted
+    double caseRatio = 0.2;         // valid lines with mixed case
+    double abbrevRatio = 0.5;       // valid lines given as one letter
+    double badCharRatio = 0.5;      // invalid lines with a bad byte,
+                                    // the rest are unknown words
+    unsigned maxLen = 0;            // pad lines up to this length
+    uint64_t sessions = 0;          // > 0 adds s=, n= and t= fields
+    uint64_t rate = 0;              // lines per second, 0 = no pacing
+    uint64_t timeBaseMs = 0;        // t= of the first line, 0 = now
+    uint64_t seed = 1;
+    bool quit = false;              // include quit commands
+};
+
+//----------------------------------------------------------------------
+// - parses one generator option at argv[i], advancing i past its value
+// - returns false if argv[i] is not a generator option
+//----------------------------------------------------------------------
+bool parseGenOption(int argc, char* argv[], int& i, GenOptions& opt);
+
+//----------------------------------------------------------------------
+// LoadGenerator : produces the lines for a GenOptions mix
+//----------------------------------------------------------------------
+class LoadGenerator {
+public:
+    explicit LoadGenerator(const GenOptions& opt);
+
+    // appends the next line, newline included
+    void next(std::string& out);
+
+private:
+    GenOptions opt;
+    uint64_t state;
+    uint64_t timeBaseMs;            // Unix epoch ms, see envelope.h
+    uint64_t produced = 0;
+
+    uint64_t random();
+    double uniform();
+};
+
+//----------------------------------------------------------------------
+// - entry point for --generate [options], writes lines to stdout
+//----------------------------------------------------------------------
+int generateMain(int argc, char* argv[]);
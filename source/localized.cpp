@@ -0,0 +1,252 @@
+//----------------------------------------------------------------------
+// localized.cpp
+//
+// Localized vocabulary, UTF-8 case folding and the ASCII check.
+//
+// Names are written with escapes so the source stays ASCII for every
+// compiler code page.
+//----------------------------------------------------------------------
+#include "localized.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CMD_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// longest localized name in bytes, longer lines cannot match
+constexpr size_t MAX_NAME = 32;
+
+//----------------------------------------------------------------------
+// the vocabulary, lowercase, as folded by foldCodePoint()
+// - only names with a multibyte character: an ASCII line never gets
+//   here, and folding never turns a multibyte line into ASCII
+//----------------------------------------------------------------------
+struct LocalName {
+    const char* name;
+    Command cmd;
+};
+
+const LocalName VOCABULARY[] = {
+    { "\xD0\xB2\xD0\xBE\xD1\x81\xD0\xBF\xD1\x80\xD0\xBE\xD0\xB8"
+      "\xD0\xB7\xD0\xB2\xD0\xB5\xD1\x81\xD1\x82\xD0\xB8",
+      CMD_PLAY },                                       // воспроизвести
+
+    { "\xD0\xBF\xD0\xB0\xD1\x83\xD0\xB7\xD0\xB0", CMD_PAUSE },  // пауза
+
+    { "zur\xC3\xBC" "ckspulen", CMD_REWIND },           // zurückspulen
+
+    { "avance-r\xC3\xA1pide", CMD_FAST_FORWARD },       // avance-rápide
+    { "avance-r\xC3\xA1pido", CMD_FAST_FORWARD },       // avance-rápido
+
+    { "arr\xC3\xAAt", CMD_STOP },                       // arrêt
+    { "\xD1\x81\xD1\x82\xD0\xBE\xD0\xBF", CMD_STOP },   // стоп
+
+    { "\xD0\xB2\xD1\x8B\xD1\x85\xD0\xBE\xD0\xB4", CMD_QUIT },   // выход
+};
+
+bool lookup(const char* folded, size_t len, Command& cmd) {
+    for (const LocalName& n : VOCABULARY) {
+        if (strlen(n.name) == len && !memcmp(n.name, folded, len)) {
+            cmd = n.cmd;
+            return true;
+        }
+    }
+    return false;
+}
+
+//----------------------------------------------------------------------
+// - simple lowercase mapping for the scripts the vocabulary uses
+//----------------------------------------------------------------------
+uint32_t foldCodePoint(uint32_t cp) {
+    if (cp >= 'A' && cp <= 'Z') {
+        return cp + 0x20;
+    }
+    // Latin-1 capitals, except the multiplication sign
+    if (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) {
+        return cp + 0x20;
+    }
+    // Latin Extended-A: capital/small pairs
+    if ((cp >= 0x100 && cp <= 0x137) || (cp >= 0x14A && cp <= 0x177)) {
+        return cp | 1;
+    }
+    if ((cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17E)) {
+        return cp & 1 ? cp + 1 : cp;
+    }
+    if (cp == 0x178) {
+        return 0xFF;
+    }
+    // Greek capitals, U+03A2 is unassigned
+    if (cp >= 0x391 && cp <= 0x3AB && cp != 0x3A2) {
+        return cp + 0x20;
+    }
+    // Cyrillic capitals
+    if (cp >= 0x410 && cp <= 0x42F) {
+        return cp + 0x20;
+    }
+    if (cp >= 0x400 && cp <= 0x40F) {
+        return cp + 0x50;
+    }
+    return cp;
+}
+
+//----------------------------------------------------------------------
+// - decodes one UTF-8 sequence at str[i], advancing i
+// - returns false on a malformed, overlong or surrogate sequence
+//----------------------------------------------------------------------
+bool decodeUtf8(const unsigned char* str, size_t len, size_t& i,
+    uint32_t& cp) {
+
+    unsigned char b = str[i];
+    size_t extra;
+    uint32_t min;
+
+    if (b < 0x80) {
+        cp = b;
+        ++i;
+        return true;
+    }
+    else if (b >= 0xC2 && b <= 0xDF) {
+        cp = b & 0x1F;
+        extra = 1;
+        min = 0x80;
+    }
+    else if (b >= 0xE0 && b <= 0xEF) {
+        cp = b & 0x0F;
+        extra = 2;
+        min = 0x800;
+    }
+    else if (b >= 0xF0 && b <= 0xF4) {
+        cp = b & 0x07;
+        extra = 3;
+        min = 0x10000;
+    }
+    else {
+        return false;
+    }
+
+    if (len - i <= extra) {
+        return false;
+    }
+    for (size_t k = 1; k <= extra; ++k) {
+        unsigned char c = str[i + k];
+        if ((c & 0xC0) != 0x80) {
+            return false;
+        }
+        cp = (cp << 6) | (c & 0x3F);
+    }
+
+    if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+        return false;
+    }
+    i += extra + 1;
+    return true;
+}
+
+//----------------------------------------------------------------------
+// - appends the UTF-8 form of cp to out, if it fits in MAX_NAME
+//----------------------------------------------------------------------
+bool encodeUtf8(uint32_t cp, char* out, size_t& n) {
+    char buf[4];
+    size_t len;
+    if (cp < 0x80) {
+        buf[0] = static_cast<char>(cp);
+        len = 1;
+    }
+    else if (cp < 0x800) {
+        buf[0] = static_cast<char>(0xC0 | (cp >> 6));
+        buf[1] = static_cast<char>(0x80 | (cp & 0x3F));
+        len = 2;
+    }
+    else if (cp < 0x10000) {
+        buf[0] = static_cast<char>(0xE0 | (cp >> 12));
+        buf[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        buf[2] = static_cast<char>(0x80 | (cp & 0x3F));
+        len = 3;
+    }
+    else {
+        buf[0] = static_cast<char>(0xF0 | (cp >> 18));
+        buf[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        buf[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        buf[3] = static_cast<char>(0x80 | (cp & 0x3F));
+        len = 4;
+    }
+
+    if (n + len > MAX_NAME) {
+        return false;
+    }
+    memcpy(out + n, buf, len);
+    n += len;
+    return true;
+}
+
+//----------------------------------------------------------------------
+// - the Unicode route: strict decode, fold, exact lookup
+//----------------------------------------------------------------------
+Command classifyMultibyte(const char* str, size_t len) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(str);
+    char folded[MAX_NAME];
+    size_t n = 0;
+    bool fits = true;
+
+    for (size_t i = 0; i < len;) {
+        uint32_t cp;
+        if (!decodeUtf8(p, len, i, cp)) {
+            return CMD_BAD_STRING;
+        }
+        fits = fits && encodeUtf8(foldCodePoint(cp), folded, n);
+    }
+
+    Command cmd;
+    if (fits && lookup(folded, n, cmd)) {
+        return cmd;
+    }
+    return CMD_BAD_STRING;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// - 16 bytes per step with SSE2: movemask collects the high bits
+// - 8 bytes per step otherwise
+//------------------------------------------------------------------------------
+bool isAscii(const char* str, size_t len) {
+    size_t i = 0;
+
+#ifdef CMD_HAVE_SSE2
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 16 <= len; i += 16) {
+        acc = _mm_or_si128(acc,
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i)));
+    }
+    if (_mm_movemask_epi8(acc)) {
+        return false;
+    }
+#endif
+
+    uint64_t bits = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, str + i, 8);
+        bits |= word;
+    }
+    for (; i < len; ++i) {
+        bits |= static_cast<unsigned char>(str[i]);
+    }
+    return !(bits & 0x8080808080808080ull);
+}
+
+//------------------------------------------------------------------------------
+bool matchLocalized(const char* str, size_t len, Command& cmd) {
+    if (isAscii(str, len)) {
+        return false;
+    }
+
+    cmd = classifyMultibyte(str, len);
+    return true;
+}
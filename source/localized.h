@@ -0,0 +1,30 @@
+//----------------------------------------------------------------------
+// localized.h
+//
+// Localized command names, in UTF-8.
+//
+// All-ASCII lines, found with a SIMD check, stay on the regular
+// first-letter rules untouched, so every line that was valid before
+// keeps its meaning. ASCII aliases such as "abspielen" belong in a
+// tenant vocabulary (see vocabulary.h), where they are opt-in.
+//
+// Lines with multibyte characters take the Unicode route: strict
+// UTF-8 decoding, simple case folding for Latin, Greek and Cyrillic,
+// then an exact lookup. A multibyte line that matches no localized
+// name is a bad string, as it always was.
+//----------------------------------------------------------------------
+#pragma once
+
+#include "cmd_validate.h"
+
+#include <cstddef>
+
+// true if no byte has its high bit set
+bool isAscii(const char* str, size_t len);
+
+//----------------------------------------------------------------------
+// - classifies a line with multibyte characters
+// - returns false for an all-ASCII line, which the regular rules
+//   should classify
+//----------------------------------------------------------------------
+bool matchLocalized(const char* str, size_t len, Command& cmd);
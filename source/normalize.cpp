@@ -0,0 +1,106 @@
+//----------------------------------------------------------------------
+// normalize.cpp
+//
+// The trim is a scan from each end. The collapse looks for the next
+// blank 16 bytes per step with SSE2, moves the bytes before it in one
+// memmove() and writes one space for the run of blanks.
+//----------------------------------------------------------------------
+#include "normalize.h"
+
+#include <bit>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CMD_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+bool normalizing = false;
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+//----------------------------------------------------------------------
+// - counts the bytes from `in` up to the next blank or `end`
+//----------------------------------------------------------------------
+size_t plainRun(const char* in, const char* end) {
+    const char* p = in;
+
+#ifdef CMD_HAVE_SSE2
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i cr = _mm_set1_epi8('\r');
+    for (; p + 16 <= end; p += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, space),
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, tab),
+                    _mm_cmpeq_epi8(chunk, cr)))));
+        if (mask) {
+            return static_cast<size_t>(p - in) + std::countr_zero(mask);
+        }
+    }
+#endif
+
+    while (p < end && !isBlank(*p)) {
+        ++p;
+    }
+    return static_cast<size_t>(p - in);
+}
+
+} // namespace
+
+void setNormalize(bool on) {
+    normalizing = on;
+}
+
+bool normalizeOn() {
+    return normalizing;
+}
+
+void trimLine(const char*& str, size_t& len) {
+    while (len > 0 && isBlank(str[len - 1])) {
+        --len;
+    }
+    while (len > 0 && isBlank(*str)) {
+        ++str;
+        --len;
+    }
+}
+
+//------------------------------------------------------------------------------
+// - `out` never passes `in`, so the moves only overwrite bytes that
+//   have been read, and a line that needs no change is not written
+//------------------------------------------------------------------------------
+size_t normalizeLine(char* str, size_t len) {
+    const char* first = str;
+    trimLine(first, len);
+
+    const char* in = first;
+    const char* end = first + len;
+    char* out = str;
+
+    while (in < end) {
+        // the bytes before the next blank
+        size_t plain = plainRun(in, end);
+        if (out != in) {
+            memmove(out, in, plain);
+        }
+        in += plain;
+        out += plain;
+
+        // a run of blanks, never the last bytes after the trim
+        if (in < end) {
+            *out++ = ' ';
+            while (isBlank(*in)) {
+                ++in;
+            }
+        }
+    }
+
+    return static_cast<size_t>(out - str);
+}
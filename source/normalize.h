@@ -0,0 +1,35 @@
+//----------------------------------------------------------------------
+// normalize.h
+//
+// Optional input normalization, turned on with --normalize, so that
+// harmless variations such as "play\r" or " stop " are accepted
+// instead of paying for a rejection:
+//
+// - leading and trailing blanks are trimmed
+// - CRs are treated as blanks, so a CRLF line end goes away
+// - runs of inner blanks become a single space
+//
+// Blanks are ' ', '\t' and '\r'.
+//----------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+
+// turns normalization on or off for every mode
+void setNormalize(bool on);
+bool normalizeOn();
+
+//----------------------------------------------------------------------
+// - normalizes [str, str + len) in place, moving the bytes to the
+//   front of the buffer
+// - returns the new length
+//----------------------------------------------------------------------
+size_t normalizeLine(char* str, size_t len);
+
+//----------------------------------------------------------------------
+// - trims the view without touching the bytes, for input that has to
+//   be passed on unchanged (filter mode)
+// - inner blanks are left alone: any blank makes a line a bad string,
+//   one space or several
+//----------------------------------------------------------------------
+void trimLine(const char*& str, size_t& len);
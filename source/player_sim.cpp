@@ -0,0 +1,241 @@
+//----------------------------------------------------------------------
+// player_sim.cpp
+//
+// Each tick first applies the commands that arrived since the last
+// one, scattered to their players, then advances all players:
+//
+//     position = min(max(position + velocity * dt, 0), length)
+//
+// which has no branches, so SSE does it 4 players at a time.
+//
+// Ticks are paced to the tick rate unless --max is given. Either way
+// the time spent inside ticks is measured, and ticks/s is the rate a
+// core could sustain for this many players.
+//----------------------------------------------------------------------
+#include "player_sim.h"
+#include "engines.h"
+#include "envelope.h"
+#include "loadgen.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CMD_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::cerr;
+using std::cout;
+using std::string;
+
+namespace {
+
+// media seconds per second for each opcode
+constexpr float PLAY_SPEED = 1.0f;
+constexpr float SEEK_SPEED = 8.0f;
+
+} // namespace
+
+PlayerSim::PlayerSim(size_t players, float mediaSeconds)
+    : position(players, 0.0f), velocity(players, 0.0f),
+    length(players, mediaSeconds), done(players, 0) {}
+
+void PlayerSim::apply(uint64_t session, Command cmd) {
+    size_t i = static_cast<size_t>(session % position.size());
+    if (done[i]) {
+        return;
+    }
+
+    switch (cmd) {
+    case CMD_PLAY:
+        velocity[i] = PLAY_SPEED;
+        break;
+    case CMD_PAUSE:
+        velocity[i] = 0.0f;
+        break;
+    case CMD_REWIND:
+        velocity[i] = -SEEK_SPEED;
+        break;
+    case CMD_FAST_FORWARD:
+        velocity[i] = SEEK_SPEED;
+        break;
+    case CMD_STOP:
+        velocity[i] = 0.0f;
+        position[i] = 0.0f;
+        break;
+    case CMD_QUIT:
+        velocity[i] = 0.0f;
+        done[i] = 1;
+        break;
+    default:
+        break;
+    }
+}
+
+void PlayerSim::tick(float dt) {
+    size_t n = position.size();
+    float* pos = position.data();
+    const float* vel = velocity.data();
+    const float* len = length.data();
+    size_t i = 0;
+
+#ifdef CMD_HAVE_SSE2
+    const __m128 step = _mm_set1_ps(dt);
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) {
+        __m128 p = _mm_add_ps(_mm_loadu_ps(pos + i),
+            _mm_mul_ps(_mm_loadu_ps(vel + i), step));
+        p = _mm_min_ps(_mm_max_ps(p, zero), _mm_loadu_ps(len + i));
+        _mm_storeu_ps(pos + i, p);
+    }
+#endif
+
+    for (; i < n; ++i) {
+        float p = pos[i] + vel[i] * dt;
+        p = p < 0.0f ? 0.0f : p;
+        pos[i] = p < len[i] ? p : len[i];
+    }
+}
+
+double PlayerSim::checksum() const {
+    double sum = 0;
+    for (float p : position) {
+        sum += p;
+    }
+    return sum;
+}
+
+//------------------------------------------------------------------------------
+// - entry point for --simulate
+//------------------------------------------------------------------------------
+int simulateMain(int argc, char* argv[]) {
+    size_t players = 1000000;
+    unsigned tickRate = 30;
+    uint64_t ticks = 300;
+    uint64_t perTick = 0;           // 0: 1% of the players
+    bool paced = true;
+
+    // abbreviations stay on: the word "pause" validates as play (the
+    // first letter decides), so only 'a' lines pause a player
+    GenOptions gen;
+    gen.quit = false;
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--players") && hasValue) {
+            players = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--tick-rate") && hasValue) {
+            tickRate = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (!strcmp(argv[i], "--ticks") && hasValue) {
+            ticks = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--commands-per-tick") && hasValue) {
+            perTick = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--max")) {
+            paced = false;
+        }
+        else if (!parseGenOption(argc, argv, i, gen)) {
+            cerr << "Usage: --simulate [--players n] [--tick-rate hz]"
+                " [--ticks n] [--commands-per-tick n] [--max]"
+                " [generator options, see --generate]\n";
+            return 2;
+        }
+    }
+    if (players == 0 || tickRate == 0) {
+        cerr << "--players and --tick-rate must be positive\n";
+        return 2;
+    }
+    if (perTick == 0) {
+        perTick = players / 100 ? players / 100 : 1;
+    }
+
+    // the stream addresses players through its s= field
+    gen.sessions = players;
+    gen.rate = 0;
+    gen.lines = ticks * perTick;
+    LoadGenerator source(gen);
+
+    PlayerSim sim(players, 3600.0f);
+    const float dt = 1.0f / tickRate;
+
+    using Clock = std::chrono::steady_clock;
+    const auto period = std::chrono::nanoseconds(1000000000 / tickRate);
+    auto due = Clock::now();
+    Clock::duration busy{};
+    Clock::duration commandTime{};
+    uint64_t applied = 0;
+    uint64_t byCommand[CMD_NUM_COMMANDS] = {};
+
+    string line;
+    for (uint64_t t = 0; t < ticks; ++t) {
+        if (paced) {
+            std::this_thread::sleep_until(due);
+            due += period;
+        }
+
+        // commands are generated outside the measured time
+        string batch;
+        for (uint64_t k = 0; k < perTick; ++k) {
+            source.next(batch);
+        }
+
+        auto start = Clock::now();
+        for (size_t p = 0; p < batch.size();) {
+            size_t nl = batch.find('\n', p);
+            Envelope env = parseEnvelope(batch.data() + p, nl - p);
+            Command cmd = classifyLine(env.command, env.commandLen);
+            if (isAccepted(cmd) && env.hasSession) {
+                sim.apply(env.session, cmd);
+                ++applied;
+                ++byCommand[cmd];
+            }
+            p = nl + 1;
+        }
+        auto mid = Clock::now();
+        sim.tick(dt);
+        auto end = Clock::now();
+
+        commandTime += mid - start;
+        busy += end - start;
+    }
+
+    using std::chrono::duration;
+    double busySec = duration<double>(busy).count();
+    double tickSec = busySec - duration<double>(commandTime).count();
+    double ticksPerSec = busySec > 0 ? ticks / busySec : 0;
+
+    cout << players << " players, " << ticks << " ticks at " << tickRate
+        << " Hz, " << applied << " commands applied\n";
+    cout << "  applied by opcode:     ";
+    for (int c = 0; c < CMD_NUM_COMMANDS; ++c) {
+        if (byCommand[c]) {
+            cout << ' ' << commandName(static_cast<Command>(c)) << '='
+                << byCommand[c];
+        }
+    }
+    cout << '\n';
+    cout << "  ticks/s (one core):     " << static_cast<uint64_t>(ticksPerSec)
+        << '\n';
+    cout << "  ns per player per tick: "
+        << (ticks ? tickSec * 1e9 / (double(ticks) * players) : 0)
+        << " (advance only)\n";
+    cout << "  ns per command:         "
+        << (applied ? duration<double>(commandTime).count() * 1e9 / applied : 0)
+        << " (parse, validate, apply)\n";
+    cout << "  players per core at " << tickRate << " Hz: "
+        << static_cast<uint64_t>(players * ticksPerSec / tickRate) << '\n';
+    cout << "  checksum:               " << sim.checksum() << '\n';
+    return 0;
+}
@@ -0,0 +1,51 @@
+//----------------------------------------------------------------------
+// player_sim.h
+//
+// Simulated players as a stand-in backend for load tests: validated
+// opcodes from a generated command stream drive the play position of
+// one player per session, advanced every tick.
+//
+// The players are kept as structure-of-arrays, one array per field, so
+// a tick is a straight pass over contiguous floats, 4 players per SSE
+// step.
+//----------------------------------------------------------------------
+#pragma once
+
+#include "cmd_validate.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//----------------------------------------------------------------------
+// PlayerSim : play position and speed of each session's player
+//----------------------------------------------------------------------
+class PlayerSim {
+public:
+    // - players, each with a media length in seconds
+    PlayerSim(size_t players, float mediaSeconds);
+
+    // - applies a validated opcode to one player
+    void apply(uint64_t session, Command cmd);
+
+    // - advances every player by dt seconds, clamped to the media
+    void tick(float dt);
+
+    size_t size() const { return position.size(); }
+
+    // sum of all positions, to check two runs agree
+    double checksum() const;
+
+private:
+    std::vector<float> position;    // seconds into the media
+    std::vector<float> velocity;    // media seconds per second
+    std::vector<float> length;
+    std::vector<uint8_t> done;      // quit, ignores further opcodes
+};
+
+//----------------------------------------------------------------------
+// - entry point for --simulate [--players n] [--tick-rate hz]
+//   [--ticks n] [--commands-per-tick n] [--max] [generator options]
+// - reports ticks/s and how many players one core keeps at the rate
+//----------------------------------------------------------------------
+int simulateMain(int argc, char* argv[]);
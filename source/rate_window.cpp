@@ -0,0 +1,192 @@
+//----------------------------------------------------------------------
+// rate_window.cpp
+//
+// Per-session tumbling and sliding window counters.
+//
+// Input lines carry a session and a millisecond timestamp in their
+// envelope (s= and t=). Lines without t= are stamped with the wall
+// clock when read.
+//----------------------------------------------------------------------
+#include "rate_window.h"
+#include "engines.h"
+#include "envelope.h"
+#include "line_index.h"
+#include "normalize.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::cerr;
+using std::cout;
+
+namespace {
+
+// names of the counter columns in the summaries
+const char* const COLUMN_NAMES[CMD_NUM_COMMANDS + 1] = {
+    "play", "pause", "rewind", "fast-forward", "stop", "quit", "rejected"
+};
+
+} // namespace
+
+//------------------------------------------------------------------------------
+SessionRateAggregator::SessionRateAggregator(std::ostream& out,
+    unsigned windowSeconds)
+    : out(out),
+      slots(windowSeconds == 0 ? 1
+          : windowSeconds > MAX_WINDOW ? MAX_WINDOW : windowSeconds) {
+}
+
+//------------------------------------------------------------------------------
+// - returns the counter row for the second's slot in the session ring
+//------------------------------------------------------------------------------
+uint32_t* SessionRateAggregator::slot(uint32_t idx, uint64_t second) {
+    size_t base = static_cast<size_t>(idx) * slots * COLUMNS;
+    return &counts[base + (second % slots) * COLUMNS];
+}
+
+//------------------------------------------------------------------------------
+// - advances the session clock as needed and bumps one counter
+//------------------------------------------------------------------------------
+void SessionRateAggregator::add(uint64_t session, uint64_t second,
+    Command cmd) {
+
+    unsigned column = isAccepted(cmd) ? cmd : CMD_NUM_COMMANDS;
+
+    auto found = index.find(session);
+    uint32_t idx;
+    if (found == index.end()) {
+        idx = static_cast<uint32_t>(current.size());
+        index.emplace(session, idx);
+        sessionIds.push_back(session);
+        current.push_back(second);
+        counts.resize(counts.size() + static_cast<size_t>(slots) * COLUMNS);
+    }
+    else {
+        idx = found->second;
+    }
+
+    uint64_t cur = current[idx];
+    if (second > cur) {
+        // close each elapsed second and clear the slot the next one
+        // reuses; after a full ring of seconds every slot is clear
+        for (uint64_t s = cur; s < second && s - cur < slots; ++s) {
+            closeSecond(idx, s);
+            memset(slot(idx, s + 1), 0, COLUMNS * sizeof(uint32_t));
+        }
+        current[idx] = second;
+    }
+    else if (cur - second >= slots) {
+        ++late;
+        return;
+    }
+
+    // a late event inside the window only shows in the sliding sums
+    ++slot(idx, second)[column];
+}
+
+//------------------------------------------------------------------------------
+// - emits the tumbling summary of one second and the sliding summary
+//   of the window ending at it
+//------------------------------------------------------------------------------
+void SessionRateAggregator::closeSecond(uint32_t idx, uint64_t second) {
+    emit("tumbling", idx, second, slot(idx, second));
+
+    uint32_t sum[COLUMNS] = {};
+    for (unsigned i = 0; i < slots; ++i) {
+        const uint32_t* row = slot(idx, i);
+        for (unsigned c = 0; c < COLUMNS; ++c) {
+            sum[c] += row[c];
+        }
+    }
+    emit("sliding", idx, second, sum);
+}
+
+//------------------------------------------------------------------------------
+// - prints the non-zero counters of a row, nothing if all are zero
+//------------------------------------------------------------------------------
+void SessionRateAggregator::emit(const char* kind, uint32_t idx,
+    uint64_t second, const uint32_t* row) {
+
+    bool any = false;
+    for (unsigned c = 0; c < COLUMNS; ++c) {
+        any = any || row[c] != 0;
+    }
+    if (!any) {
+        return;
+    }
+
+    out << kind << " s=" << sessionIds[idx] << " t=" << second;
+    if (kind[0] == 's') {
+        out << " w=" << slots;
+    }
+    for (unsigned c = 0; c < COLUMNS; ++c) {
+        if (row[c]) {
+            out << ' ' << COLUMN_NAMES[c] << '=' << row[c];
+        }
+    }
+    out << '\n';
+}
+
+void SessionRateAggregator::flush() {
+    for (uint32_t idx = 0; idx < current.size(); ++idx) {
+        closeSecond(idx, current[idx]);
+    }
+    out.flush();
+}
+
+//------------------------------------------------------------------------------
+// - entry point for --aggregate
+//------------------------------------------------------------------------------
+int aggregateMain(int argc, char* argv[]) {
+    unsigned window = 10;
+    if (argc == 2 && !strcmp(argv[0], "--window")) {
+        window = static_cast<unsigned>(strtoul(argv[1], nullptr, 10));
+    }
+    else if (argc != 0) {
+        cerr << "Usage: --aggregate [--window <seconds>]\n";
+        return 2;
+    }
+
+    SessionRateAggregator agg(cout, window);
+
+    // a line over --max-line has no trustworthy fields, it is skipped
+    char* line;
+    size_t len;
+    BlockLineReader reader(stdin);
+    uint64_t tooLong = 0;
+    while (true) {
+        LineReader::Result got = reader.next(line, len);
+        if (got == LineReader::END) {
+            break;
+        }
+        if (got == LineReader::LINE_TOO_LONG) {
+            ++tooLong;
+            continue;
+        }
+
+        if (normalizeOn()) {
+            len = normalizeLine(line, len);
+        }
+        Envelope env = parseEnvelope(line, len);
+
+        uint64_t ms = env.hasTime ? env.timeMs : wallClockMs();
+
+        Command cmd = classifyLine(env.command, env.commandLen);
+        agg.add(env.session, ms / 1000, cmd);
+    }
+    agg.flush();
+
+    if (tooLong) {
+        cerr << "skipped " << tooLong << " lines over " << maxLine()
+            << " bytes\n";
+    }
+    if (agg.lateDropped()) {
+        cerr << "dropped " << agg.lateDropped() << " late events\n";
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+//----------------------------------------------------------------------
+// rate_window.h
+//
+// Streaming per-session command counts over one-second tumbling
+// windows and an N-second sliding window.
+//----------------------------------------------------------------------
+#pragma once
+
+#include "cmd_validate.h"
+
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+//----------------------------------------------------------------------
+// SessionRateAggregator : counts commands per session per second
+//
+// Each session owns a ring of one-second slots in one flat counter
+// array, so no events are kept. When a session's clock moves past a
+// second, that second is closed: its own counts are emitted as a
+// tumbling summary, and the sum of the ring as a sliding summary.
+//----------------------------------------------------------------------
+class SessionRateAggregator {
+public:
+    // widest sliding window, in seconds
+    static constexpr unsigned MAX_WINDOW = 3600;
+
+    SessionRateAggregator(std::ostream& out, unsigned windowSeconds = 10);
+
+    // - counts one command, or a rejection, for a session
+    // - events older than the sliding window are dropped and counted
+    void add(uint64_t session, uint64_t second, Command cmd);
+
+    // closes the current second of every session
+    void flush();
+
+    uint64_t lateDropped() const { return late; }
+    size_t sessionCount() const { return current.size(); }
+
+private:
+    // one counter per command plus one for rejections
+    static constexpr unsigned COLUMNS = CMD_NUM_COMMANDS + 1;
+
+    std::ostream& out;
+    unsigned slots;
+    uint64_t late = 0;
+
+    std::unordered_map<uint64_t, uint32_t> index;
+    std::vector<uint64_t> sessionIds;
+    std::vector<uint64_t> current;      // newest second per session
+    std::vector<uint32_t> counts;       // [session][slot][column]
+
+    uint32_t* slot(uint32_t idx, uint64_t second);
+    void closeSecond(uint32_t idx, uint64_t second);
+    void emit(const char* kind, uint32_t idx, uint64_t second,
+        const uint32_t* row);
+};
+
+//----------------------------------------------------------------------
+// - entry point for --aggregate [--window <seconds>]
+// - reads enveloped commands from stdin, see envelope.h
+//----------------------------------------------------------------------
+int aggregateMain(int argc, char* argv[]);
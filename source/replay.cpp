@@ -0,0 +1,313 @@
+//----------------------------------------------------------------------
+// replay.cpp
+//
+// Records input lines with microsecond arrival times and replays them
+// with the same inter-arrival gaps, scaled by the speed factor.
+//
+// Lines that arrive in one read() share its timestamp, so bursts keep
+// their shape as far as the reader saw it.
+//
+// Recording finds the line ends of each read() with a LineIndex.
+// Replay has no newlines to find, the recording stores each line with
+// its length.
+//
+// Replay latency is measured from the time a line is due to the time
+// its answer is ready. When the validator falls behind, lines queue up
+// and the latency shows it, which is what a burst looks like live.
+//----------------------------------------------------------------------
+#include "replay.h"
+#include "cmd_validate.h"
+#include "engines.h"
+#include "harness.h"
+#include "line_index.h"
+#include "normalize.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::cerr;
+using std::cout;
+using std::string;
+using std::vector;
+
+namespace {
+
+#ifdef _WIN32
+int readInput(char* buf, unsigned size) {
+    return _read(0, buf, size);
+}
+#else
+ssize_t readInput(char* buf, size_t size) {
+    return read(0, buf, size);
+}
+#endif
+
+const char RECORD_MAGIC[4] = { 'C', 'M', 'D', 'R' };
+constexpr unsigned char RECORD_VERSION = 1;
+
+// closer than this to the due time, spin instead of sleeping
+constexpr uint64_t SPIN_US = 200;
+
+using Clock = std::chrono::steady_clock;
+
+uint64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now().time_since_epoch()).count();
+}
+
+void putVarint(string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out += static_cast<char>(v | 0x80);
+        v >>= 7;
+    }
+    out += static_cast<char>(v);
+}
+
+//----------------------------------------------------------------------
+// - reads a varint at p, advancing it
+// - returns false if the data ends first
+//----------------------------------------------------------------------
+bool getVarint(const unsigned char*& p, const unsigned char* end,
+    uint64_t& v) {
+
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        unsigned char b = *p++;
+        v |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//----------------------------------------------------------------------
+// Recorded : a recording loaded into memory
+//----------------------------------------------------------------------
+struct Recorded {
+    vector<unsigned char> data;
+    struct Line {
+        uint64_t offsetUs;          // since the first line
+        size_t start;
+        size_t len;
+    };
+    vector<Line> lines;
+};
+
+bool loadRecording(const char* path, Recorded& rec) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+
+    unsigned char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof buf, f)) > 0) {
+        rec.data.insert(rec.data.end(), buf, buf + n);
+    }
+    fclose(f);
+
+    if (rec.data.size() < 5 || memcmp(rec.data.data(), RECORD_MAGIC, 4)
+        || rec.data[4] != RECORD_VERSION) {
+        return false;
+    }
+
+    const unsigned char* base = rec.data.data();
+    const unsigned char* p = base + 5;
+    const unsigned char* end = base + rec.data.size();
+    uint64_t offset = 0;
+
+    while (p < end) {
+        uint64_t delta, len;
+        if (!getVarint(p, end, delta) || !getVarint(p, end, len)
+            || len > static_cast<uint64_t>(end - p)) {
+            return false;
+        }
+
+        offset += rec.lines.empty() ? 0 : delta;
+        rec.lines.push_back({ offset, static_cast<size_t>(p - base),
+            static_cast<size_t>(len) });
+        p += len;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------
+// - waits until the due time, sleeping while it is far off
+//----------------------------------------------------------------------
+void waitUntil(uint64_t dueUs) {
+    uint64_t now = nowUs();
+    if (dueUs > now + SPIN_US) {
+        std::this_thread::sleep_for(
+            std::chrono::microseconds(dueUs - now - SPIN_US));
+    }
+    while (nowUs() < dueUs) {
+    }
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// - entry point for --record
+//------------------------------------------------------------------------------
+int recordMain(int argc, char* argv[]) {
+    if (argc != 1) {
+        cerr << "Usage: --record <file>\n";
+        return 2;
+    }
+
+    FILE* out = fopen(argv[0], "wb");
+    if (!out) {
+        cerr << "Cannot write " << argv[0] << '\n';
+        return 1;
+    }
+
+    string records(RECORD_MAGIC, 4);
+    records += static_cast<char>(RECORD_VERSION);
+
+    char buf[65536];
+    string partial;
+    LineIndex index;
+    uint64_t last = 0;
+    long long n;
+
+    // fread() would wait for a full buffer, read() returns whatever
+    // has arrived so far
+    while ((n = readInput(buf, sizeof buf)) > 0) {
+        uint64_t now = nowUs();
+        fwrite(buf, 1, n, stdout);
+        fflush(stdout);
+
+        // only the new bytes are searched, the partial line had none
+        size_t from = partial.size();
+        partial.append(buf, n);
+        index.build(buf, static_cast<size_t>(n));
+
+        size_t start = 0;
+        for (uint32_t offset : index) {
+            size_t nl = from + offset;
+            putVarint(records, last ? now - last : 0);
+            putVarint(records, nl - start);
+            records.append(partial, start, nl - start);
+            last = now;
+            start = nl + 1;
+        }
+        partial.erase(0, start);
+
+        fwrite(records.data(), 1, records.size(), out);
+        records.clear();
+    }
+
+    if (!partial.empty()) {
+        putVarint(records, last ? nowUs() - last : 0);
+        putVarint(records, partial.size());
+        records += partial;
+        fwrite(records.data(), 1, records.size(), out);
+    }
+
+    return fclose(out) == 0 ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
+// - entry point for --replay
+//------------------------------------------------------------------------------
+int replayMain(int argc, char* argv[]) {
+    const char* path = nullptr;
+    double speed = 1.0;               // 0 means as fast as possible
+    bool toStdout = false;
+
+    for (int i = 0; i < argc; ++i) {
+        if (!strcmp(argv[i], "--speed") && i + 1 < argc) {
+            ++i;
+            speed = !strcmp(argv[i], "max") ? 0 : atof(argv[i]);
+        }
+        else if (!strcmp(argv[i], "--to-stdout")) {
+            toStdout = true;
+        }
+        else if (!path && argv[i][0] != '-') {
+            path = argv[i];
+        }
+        else {
+            path = nullptr;
+            break;
+        }
+    }
+    if (!path || speed < 0) {
+        cerr << "Usage: --replay <file> [--speed n|max] [--to-stdout]\n";
+        return 2;
+    }
+
+    Recorded rec;
+    if (!loadRecording(path, rec)) {
+        cerr << "Cannot read recording " << path << '\n';
+        return 1;
+    }
+
+    vector<uint64_t> latencyNs;
+    latencyNs.reserve(rec.lines.size());
+    size_t accepted = 0;
+
+    uint64_t start = nowUs();
+    for (const Recorded::Line& line : rec.lines) {
+        char* text = reinterpret_cast<char*>(&rec.data[line.start]);
+        uint64_t due = start;
+        if (speed > 0) {
+            due += static_cast<uint64_t>(line.offsetUs / speed);
+            waitUntil(due);
+        }
+        else {
+            due = nowUs();
+        }
+
+        if (toStdout) {
+            fwrite(text, 1, line.len, stdout);
+            fputc('\n', stdout);
+            fflush(stdout);
+            continue;
+        }
+
+        // in place, each recorded line is replayed once
+        size_t len = line.len;
+        if (normalizeOn()) {
+            len = normalizeLine(text, len);
+        }
+        accepted += isAccepted(classifyLine(text, len));
+        uint64_t done = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now().time_since_epoch()).count();
+        latencyNs.push_back(done - due * 1000);
+    }
+
+    if (toStdout) {
+        return 0;
+    }
+
+    double wallSec = (nowUs() - start) / 1e6;
+    double recordedSec = rec.lines.empty()
+        ? 0 : rec.lines.back().offsetUs / 1e6;
+
+    cout << rec.lines.size() << " lines (" << accepted << " accepted), "
+        << "recorded over " << recordedSec << " s, replayed in "
+        << wallSec << " s\n";
+    cout << "latency from due time, us: p50 "
+        << percentile(latencyNs, 0.50) / 1000.0
+        << ", p99 " << percentile(latencyNs, 0.99) / 1000.0
+        << ", p99.9 " << percentile(latencyNs, 0.999) / 1000.0
+        << ", max " << percentile(latencyNs, 1.0) / 1000.0 << '\n';
+    return 0;
+}
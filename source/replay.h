@@ -0,0 +1,28 @@
+//----------------------------------------------------------------------
+// replay.h
+//
+// Recording of timestamped input and replay at 1x, Nx or full speed.
+//
+// A recording is "CMDR" and a version byte, then one record per line:
+//
+//     varint  microseconds since the previous line
+//     varint  line length
+//     bytes   the line, without its newline
+//
+// Varints are LEB128, so a typical record is a few bytes plus the line.
+//----------------------------------------------------------------------
+#pragma once
+
+//----------------------------------------------------------------------
+// - entry point for --record <file>
+// - copies stdin to stdout unchanged while recording it
+//----------------------------------------------------------------------
+int recordMain(int argc, char* argv[]);
+
+//----------------------------------------------------------------------
+// - entry point for --replay <file> [--speed n|max] [--to-stdout]
+// - validates each line when it is due and reports how late the
+//   answers were, or with --to-stdout writes the lines out on time
+//   for another validator process
+//----------------------------------------------------------------------
+int replayMain(int argc, char* argv[]);
@@ -0,0 +1,861 @@
+//----------------------------------------------------------------------
+// server.cpp
+//
+// Single-threaded poll() server for the command validator.
+//
+// Each client line gets one answer line:
+//
+//     play                                   accepted command
+//     Bad string: <line>                     validateString() fails
+//     Unrecognized command exception: <line> validateCommand() fails
+//     Rate limited: <line>                   shed by admission control
+//     Stale: <line>                          past its --stale-after age
+//     Sequence too old: <line>               retry below the dedup window
+//     Line too long: <first bytes>...        over --max-line
+//
+// Lines are classified with the selected engine (see engines.h),
+// which follows the validateString()/validateCommand() rules without
+// throwing, so junk input does not pay for an exception here.
+//
+// Lines may carry envelope fields (see envelope.h); only the command
+// after them is validated, the answer echoes the whole line.
+//
+// With --stale-after, a line that waited past the deadline for its
+// opcode is dropped before admission control and validation (see
+// staleness.h). Its age counts from its t= field, or else from the
+// read() that brought its newline. "@" control lines and quit are
+// never dropped: losing either would leave the connection in the
+// wrong state.
+//
+// With --dedup, a line carrying s= and n= that repeats an earlier
+// (session, seq) gets the earlier answer and is not validated or
+// dispatched again (see dedup.h).
+//
+// With --idle-timeout, every validated command of an s= session
+// resets that session's idle timer on a hierarchical timing wheel
+// (see timer_wheel.h); a session that stays quiet that long expires
+// and its state, including its dedup window, is dropped. A session
+// that sends quit ends there and its timer is cancelled.
+//
+// Admission control gives every connection its own token bucket. A
+// connection that runs out of tokens either has its excess lines
+// shed before validation, or is deferred: we stop reading from it
+// until it has tokens again, which leaves the other clients alone.
+//
+// A line over the --max-line limit is answered as soon as the limit
+// is passed and the rest of it is dropped as it arrives, so it never
+// occupies more than the limit in memory.
+//
+// With --workers N, a master process opens the listener and forks N
+// workers that each run this loop on it, accepting in turn. Their
+// counters live in a shared stats segment (see worker_stats.h), so
+// "@stats" totals and the exit summary cover every worker. A worker
+// that crashes is replaced. Idle sessions are per worker, like the
+// connections that feed them. --dedup is refused: a retry could reach
+// a worker whose table never saw the first try.
+//
+// Rejected commands feed the --sketch-out sketches (see sketches.h)
+// by their command alone, without envelope fields that would make
+// every line distinct; too-long lines by their preview. Prefork
+// workers keep their own sketches, which are not saved.
+//
+// A client can send "@stats" to read the admission counters, and
+// "@vocab <name>" to bind the connection to a tenant vocabulary
+// loaded with --vocab (see vocabulary.h); "@vocab" alone goes back to
+// the built-in rules.
+//----------------------------------------------------------------------
+#include "server.h"
+#include "cmd_validate.h"
+#include "coro_server.h"
+#include "dedup.h"
+#include "engines.h"
+#include "envelope.h"
+#include "alloc_stats.h"
+#include "line_reader.h"
+#include "normalize.h"
+#include "server_common.h"
+#include "sketches.h"
+#include "staleness.h"
+#include "timer_wheel.h"
+#include "token_bucket.h"
+#include "vocabulary.h"
+#include "worker_stats.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::cerr;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+#ifndef _WIN32
+namespace {
+
+// stop reading from a client whose unanswered input reaches this
+constexpr size_t MAX_PENDING_INPUT = 1 << 16;
+
+//----------------------------------------------------------------------
+// ServerOptions : from the command line
+//----------------------------------------------------------------------
+struct ServerOptions {
+    const char* socketPath = nullptr;
+    uint64_t rate = 0;              // commands per second, 0 = no limit
+    uint64_t burst = 32;
+    bool shedExcess = false;        // shed instead of defer
+    size_t maxLine = 0;             // below MAX_PENDING_INPUT
+    bool coro = false;              // run the coroutine server instead
+    StalenessPolicy staleness;      // from --stale-after
+    size_t dedupSessions = 0;       // from --dedup, 0 = off
+    uint64_t idleTimeoutMs = 0;     // from --idle-timeout, 0 = off
+    size_t workers = 0;             // from --workers, 0 = no prefork
+    VocabularyRegistry vocabs;      // from --vocab <name>=<file>
+};
+
+//----------------------------------------------------------------------
+// Connection : one client
+//----------------------------------------------------------------------
+struct Connection {
+    // when the bytes of `in` up to `end` had all been read
+    struct Arrival {
+        size_t end;
+        uint64_t us;
+    };
+
+    int fd;
+    string in;                      // bytes read, not yet answered
+    vector<Arrival> arrivals;       // only kept with --stale-after
+    string out;                     // answers not yet written
+    TokenBucket bucket;
+    AdmissionCounters counters;
+    StaleCounters stale;
+    shared_ptr<const CompiledVocabulary> vocab;     // null = built-in
+    bool deferred = false;          // out of tokens, not reading
+    bool skipping = false;          // dropping the rest of a long line
+    bool eof = false;               // client finished sending
+    bool closing = false;           // close once out is written
+
+    Connection(int fd, const ServerOptions& opt)
+        : fd(fd), bucket(opt.rate, opt.burst) {}
+};
+
+//----------------------------------------------------------------------
+// Session : what we keep per s= session while it is active
+//----------------------------------------------------------------------
+struct Session {
+    TimerNode idle;                 // key is the session id
+};
+
+volatile sig_atomic_t stopRequested = 0;
+
+extern "C" void onStopSignal(int) {
+    stopRequested = 1;
+}
+
+uint64_t monotonicUs() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(
+        steady_clock::now().time_since_epoch()).count();
+}
+
+//----------------------------------------------------------------------
+// Server : connections on a listener
+// - with a stats segment, the server is one prefork worker and keeps
+//   its slot of the segment up to date
+//----------------------------------------------------------------------
+class Server {
+public:
+    explicit Server(const ServerOptions& opt, StatsSegment* shared = nullptr,
+        size_t worker = 0)
+        : opt(opt), shared(shared), worker(worker),
+          idleTimers(monotonicUs() / 1000) {
+        if (opt.dedupSessions) {
+            dedup = std::make_unique<DedupTable>(opt.dedupSessions);
+        }
+    }
+
+    // - serves listenFd until SIGINT or SIGTERM, leaves it open
+    int run(int listenFd);
+
+    // - the single-process exit summary
+    void report() const;
+
+private:
+    const ServerOptions& opt;
+    StatsSegment* shared;
+    size_t worker;
+    int listenFd = -1;
+    vector<Connection> conns;
+    AdmissionCounters total;
+    StaleCounters totalStale;
+    std::unique_ptr<DedupTable> dedup;
+    uint64_t duplicates = 0;
+    uint64_t tooOld = 0;
+
+    // sessions by id, with idle timers in milliseconds
+    std::unordered_map<uint64_t, Session> sessions;
+    TimerWheel idleTimers;
+    uint64_t expiredSessions = 0;
+
+    WorkerCounters counters() const;
+    void publish();
+    void acceptAll();
+    void readFrom(Connection& c, uint64_t nowUs);
+    bool dropIfStale(Connection& c, const char* line, size_t len,
+        const Envelope& env, uint64_t readUs, uint64_t nowUs);
+    void processLines(Connection& c, uint64_t nowUs);
+    void touchSession(uint64_t id, Command cmd, uint64_t nowUs);
+    void expireSessions(uint64_t nowUs);
+    void writeTo(Connection& c);
+    int pollTimeoutMs(uint64_t nowUs);
+};
+
+WorkerCounters Server::counters() const {
+    WorkerCounters c;
+    c.admission = total;
+    c.stale = totalStale;
+    c.expiredSessions = expiredSessions;
+    return c;
+}
+
+//------------------------------------------------------------------------------
+// - stores our running totals in our slot of the stats segment
+//------------------------------------------------------------------------------
+void Server::publish() {
+    if (shared) {
+        shared->publish(worker, counters());
+    }
+}
+
+void Server::acceptAll() {
+    while (true) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        conns.emplace_back(fd, opt);
+    }
+}
+
+void Server::readFrom(Connection& c, uint64_t nowUs) {
+    char buf[8192];
+    while (c.in.size() < MAX_PENDING_INPUT) {
+        ssize_t n = read(c.fd, buf, sizeof buf);
+        if (n > 0) {
+            c.in.append(buf, n);
+            if (opt.staleness.enabled()) {
+                c.arrivals.push_back({ c.in.size(), nowUs });
+            }
+            continue;
+        }
+        if (n == 0) {
+            // an unterminated last line still gets an answer
+            if (!c.in.empty() && c.in.back() != '\n') {
+                c.in += '\n';
+            }
+            c.eof = true;
+        }
+        else if (errno != EAGAIN && errno != EINTR) {
+            c.closing = true;
+        }
+        return;
+    }
+}
+
+//------------------------------------------------------------------------------
+// - answers every complete line the connection's bucket admits
+//------------------------------------------------------------------------------
+void Server::processLines(Connection& c, uint64_t nowUs) {
+    size_t start = 0;
+    size_t arrival = 0;
+    bool wasDeferred = c.deferred;
+    c.deferred = false;
+
+    // the rest of a too-long line is dropped as it arrives
+    if (c.skipping) {
+        size_t nl = c.in.find('\n');
+        c.skipping = nl == string::npos;
+        c.in.erase(0, c.skipping ? c.in.size() : nl + 1);
+    }
+
+    while (!c.closing) {
+        size_t nl = c.in.find('\n', start);
+        char* line = c.in.data() + start;
+
+        if (nl == string::npos) {
+            // answer now rather than buffer up to the newline
+            if (c.in.size() - start > opt.maxLine) {
+                appendTooLong(c.out, line, c.in.size() - start);
+                c.skipping = true;
+                start = c.in.size();
+            }
+            break;
+        }
+
+        size_t len = nl - start;
+        if (len > opt.maxLine) {
+            appendTooLong(c.out, line, len);
+            start = nl + 1;
+            continue;
+        }
+
+        if (normalizeOn()) {
+            len = normalizeLine(line, len);
+        }
+        Envelope env = parseEnvelope(line, len);
+
+        // stale lines go first, they should not use up tokens
+        if (opt.staleness.enabled()) {
+            while (arrival < c.arrivals.size()
+                && c.arrivals[arrival].end <= nl) {
+                ++arrival;
+            }
+            uint64_t readUs = arrival < c.arrivals.size()
+                ? c.arrivals[arrival].us : nowUs;
+            if (dropIfStale(c, line, len, env, readUs, nowUs)) {
+                start = nl + 1;
+                continue;
+            }
+        }
+
+        // admission control runs before any validation work
+        if (!c.bucket.take(nowUs)) {
+            if (!opt.shedExcess) {
+                c.deferred = true;
+                if (!wasDeferred) {
+                    ++c.counters.deferred;
+                    ++total.deferred;
+                }
+                break;
+            }
+            ++c.counters.shed;
+            ++total.shed;
+            c.out += "Rate limited: ";
+            c.out.append(line, len);
+            c.out += '\n';
+            start = nl + 1;
+            continue;
+        }
+        ++c.counters.admitted;
+        ++total.admitted;
+        ALLOC_COUNT_COMMANDS(1);
+
+        // checked once admitted, so a deferred line is not marked seen
+        bool track = dedup && env.hasSession && env.hasSeq;
+        if (track) {
+            Command stored;
+            DedupTable::Verdict verdict =
+                dedup->check(env.session, env.seq, stored);
+            if (verdict != DedupTable::FIRST) {
+                if (verdict == DedupTable::DUPLICATE) {
+                    ++duplicates;
+                    appendAnswer(c.out, line, len, stored);
+                    c.closing = stored == CMD_QUIT;
+                }
+                else {
+                    ++tooOld;
+                    c.out += "Sequence too old: ";
+                    c.out.append(line, len);
+                    c.out += '\n';
+                }
+                start = nl + 1;
+                continue;
+            }
+        }
+
+        if (len == 6 && !memcmp(line, "@stats", 6)) {
+            // a prefork worker reports the totals of all workers
+            WorkerCounters all = counters();
+            if (shared) {
+                publish();
+                all = shared->sum();
+            }
+            appendStats(c.out, c.counters, all.admission, c.stale.total,
+                all.stale.total);
+        }
+        else if (len >= 6 && !memcmp(line, "@vocab", 6)
+            && (len == 6 || line[6] == ' ')) {
+            size_t skip = len == 6 ? 6 : 7;
+            bindVocabulary(c.out, opt.vocabs, c.vocab, line + skip,
+                len - skip);
+        }
+        else {
+            Command cmd = classifyWithVocabulary(c.vocab.get(),
+                env.command, env.commandLen);
+            if (track) {
+                dedup->store(cmd);
+            }
+            if (!isAccepted(cmd)) {
+                if (sketchesEnabled()) {
+                    rejectSketches().add(env.command, env.commandLen);
+                }
+            }
+            else if (env.hasSession) {
+                touchSession(env.session, cmd, nowUs);
+            }
+            appendAnswer(c.out, line, len, cmd);
+            if (cmd == CMD_QUIT) {
+                c.closing = true;
+            }
+        }
+        start = nl + 1;
+    }
+
+    c.in.erase(0, start);
+
+    // arrivals are kept relative to the front of `in`
+    size_t kept = 0;
+    for (Connection::Arrival& a : c.arrivals) {
+        if (a.end > start) {
+            c.arrivals[kept++] = { a.end - start, a.us };
+        }
+    }
+    c.arrivals.resize(kept);
+
+    if (c.eof && !c.deferred) {
+        c.closing = true;
+    }
+}
+
+//------------------------------------------------------------------------------
+// - pushes the session's expiry back after a validated command
+// - quit ends the session: its timer is cancelled, its dedup window
+//   kept so a retried quit still gets its answer
+//------------------------------------------------------------------------------
+void Server::touchSession(uint64_t id, Command cmd, uint64_t nowUs) {
+    if (!opt.idleTimeoutMs) {
+        return;
+    }
+
+    if (cmd == CMD_QUIT) {
+        auto it = sessions.find(id);
+        if (it != sessions.end()) {
+            idleTimers.cancel(it->second.idle);
+            sessions.erase(it);
+        }
+        return;
+    }
+
+    Session& s = sessions[id];
+    s.idle.key = id;
+    idleTimers.schedule(s.idle, nowUs / 1000 + opt.idleTimeoutMs);
+}
+
+void Server::expireSessions(uint64_t nowUs) {
+    idleTimers.advance(nowUs / 1000, [this](TimerNode& timer) {
+        uint64_t id = timer.key;
+        if (dedup) {
+            dedup->forget(id);
+        }
+        // frees the timer too, the wheel has let go of it already
+        sessions.erase(id);
+        ++expiredSessions;
+    });
+}
+
+//------------------------------------------------------------------------------
+// - answers and counts a line past its opcode's deadline
+// - returns false if the line is fresh enough to validate
+//------------------------------------------------------------------------------
+bool Server::dropIfStale(Connection& c, const char* line, size_t len,
+    const Envelope& env, uint64_t readUs, uint64_t nowUs) {
+
+    // a late "@vocab" still has to rebind the connection
+    if (len > 0 && line[0] == '@') {
+        return false;
+    }
+
+    uint64_t ageUs = nowUs - readUs;
+    if (env.hasTime) {
+        uint64_t wallMs = wallClockMs();
+        ageUs = wallMs > env.timeMs ? (wallMs - env.timeMs) * 1000 : 0;
+    }
+
+    // tenant and localized words do not follow the first letter, so
+    // those lines take the full lookup
+    bool multibyte = env.commandLen > 0 && (env.command[0] & 0x80);
+    Command predicted = c.vocab || multibyte
+        ? classifyWithVocabulary(c.vocab.get(), env.command, env.commandLen)
+        : StalenessPolicy::predict(env.command, env.commandLen);
+    if (predicted == CMD_QUIT || !opt.staleness.isStale(predicted, ageUs)) {
+        return false;
+    }
+
+    c.stale.add(predicted);
+    totalStale.add(predicted);
+    c.out += "Stale: ";
+    c.out.append(line, len);
+    c.out += '\n';
+    return true;
+}
+
+void Server::writeTo(Connection& c) {
+    while (!c.out.empty()) {
+        ssize_t n = write(c.fd, c.out.data(), c.out.size());
+        if (n > 0) {
+            c.out.erase(0, n);
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            c.out.clear();
+            c.closing = true;
+        }
+        return;
+    }
+}
+
+//------------------------------------------------------------------------------
+// - a deferred connection needs waking when its next token is due
+//------------------------------------------------------------------------------
+int Server::pollTimeoutMs(uint64_t nowUs) {
+    uint64_t wait = UINT64_MAX;
+    for (Connection& c : conns) {
+        if (c.deferred) {
+            uint64_t w = c.bucket.waitUs(nowUs);
+            wait = w < wait ? w : wait;
+        }
+    }
+
+    // the idle timers tick in milliseconds
+    uint64_t ticks = idleTimers.ticksUntilNext();
+    if (ticks != UINT64_MAX) {
+        uint64_t w = ticks * 1000;
+        wait = w < wait ? w : wait;
+    }
+
+    if (wait == UINT64_MAX) {
+        return -1;
+    }
+    return static_cast<int>((wait + 999) / 1000);
+}
+
+int Server::run(int fd) {
+    listenFd = fd;
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, onStopSignal);
+    signal(SIGTERM, onStopSignal);
+
+    vector<pollfd> fds;
+    while (!stopRequested) {
+        uint64_t now = monotonicUs();
+
+        fds.clear();
+        fds.push_back({ listenFd, POLLIN, 0 });
+        for (Connection& c : conns) {
+            short events = 0;
+            if (!c.deferred && !c.eof && !c.closing
+                && c.in.size() < MAX_PENDING_INPUT) {
+                events |= POLLIN;
+            }
+            if (!c.out.empty()) {
+                events |= POLLOUT;
+            }
+            // a negative fd is skipped, so a hung-up client that is
+            // waiting for tokens does not wake us with POLLHUP
+            fds.push_back({ events ? c.fd : -1, events, 0 });
+        }
+
+        if (poll(fds.data(), fds.size(), pollTimeoutMs(now)) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll");
+            break;
+        }
+        now = monotonicUs();
+        expireSessions(now);
+
+        if (fds[0].revents & POLLIN) {
+            acceptAll();
+        }
+
+        // connections accepted above have no pollfd yet
+        for (size_t i = 0; i + 1 < fds.size(); ++i) {
+            Connection& c = conns[i];
+            short rev = fds[i + 1].revents;
+
+            if (rev & (POLLIN | POLLHUP | POLLERR) && !c.eof) {
+                readFrom(c, now);
+            }
+            processLines(c, now);
+            if (rev & POLLOUT || !c.out.empty()) {
+                writeTo(c);
+            }
+        }
+
+        // drop finished connections
+        for (size_t i = conns.size(); i-- > 0;) {
+            if (conns[i].closing && conns[i].out.empty()) {
+                close(conns[i].fd);
+                conns.erase(conns.begin() + i);
+            }
+        }
+
+        publish();
+    }
+
+    for (Connection& c : conns) {
+        close(c.fd);
+    }
+    publish();
+    return 0;
+}
+
+void Server::report() const {
+    cerr << "admitted " << total.admitted << ", shed " << total.shed
+        << ", deferred " << total.deferred << ", "
+        << totalStale.format() << '\n';
+    if (opt.idleTimeoutMs) {
+        cerr << "sessions active " << sessions.size() << ", expired "
+            << expiredSessions << '\n';
+    }
+    if (dedup) {
+        cerr << "duplicates " << duplicates << ", too old " << tooOld
+            << ", evicted sessions " << dedup->evictions() << " ("
+            << dedup->capacity() << " sessions in "
+            << dedup->bytes() / 1024 << " KB)\n";
+    }
+}
+
+//----------------------------------------------------------------------
+// - forks one worker that serves listenFd into slot `worker`
+// - returns the child's pid, or -1
+//----------------------------------------------------------------------
+pid_t spawnWorker(const ServerOptions& opt, int listenFd,
+    StatsSegment& stats, size_t worker) {
+
+    cerr.flush();
+    pid_t pid = fork();
+    if (pid != 0) {
+        return pid;
+    }
+
+    // the worker must not run the master's exit-time reporting
+    Server server(opt, &stats, worker);
+    _exit(server.run(listenFd));
+}
+
+//----------------------------------------------------------------------
+// - the prefork master: forks the workers, replaces any that die and
+//   on SIGINT or SIGTERM stops them and sums their counters
+//----------------------------------------------------------------------
+int runPrefork(const ServerOptions& opt, int listenFd) {
+    StatsSegment stats(opt.workers);
+    if (!stats.ok()) {
+        perror("mmap");
+        return 1;
+    }
+
+    // no SA_RESTART, so a stop signal interrupts waitpid()
+    struct sigaction sa = {};
+    sa.sa_handler = onStopSignal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    vector<pid_t> pids(opt.workers, -1);
+    for (size_t i = 0; i < pids.size(); ++i) {
+        pids[i] = spawnWorker(opt, listenFd, stats, i);
+        if (pids[i] < 0) {
+            perror("fork");
+            stopRequested = 1;
+            break;
+        }
+    }
+
+    uint64_t restarts = 0;
+    while (!stopRequested) {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("waitpid");
+            break;
+        }
+
+        size_t i = 0;
+        while (i < pids.size() && pids[i] != pid) {
+            ++i;
+        }
+        if (i == pids.size()) {
+            continue;
+        }
+
+        stats.retire(i);
+        pids[i] = -1;
+        if (stopRequested) {
+            break;
+        }
+
+        if (WIFSIGNALED(status)) {
+            cerr << "worker " << i << " killed by signal "
+                << WTERMSIG(status) << ", restarting\n";
+        }
+        else {
+            cerr << "worker " << i << " exited with "
+                << WEXITSTATUS(status) << ", restarting\n";
+        }
+        pids[i] = spawnWorker(opt, listenFd, stats, i);
+        ++restarts;
+    }
+
+    for (pid_t pid : pids) {
+        if (pid > 0) {
+            kill(pid, SIGTERM);
+        }
+    }
+    for (size_t i = 0; i < pids.size(); ++i) {
+        if (pids[i] > 0) {
+            waitpid(pids[i], nullptr, 0);
+            stats.retire(i);
+        }
+    }
+
+    WorkerCounters all = stats.sum();
+    cerr << "workers " << opt.workers << ", restarts " << restarts << '\n';
+    cerr << "admitted " << all.admission.admitted << ", shed "
+        << all.admission.shed << ", deferred " << all.admission.deferred
+        << ", " << all.stale.format() << '\n';
+    if (opt.idleTimeoutMs) {
+        cerr << "sessions expired " << all.expiredSessions << '\n';
+    }
+    return 0;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// - entry point for --server
+//------------------------------------------------------------------------------
+int serverMain(int argc, char* argv[]) {
+    ServerOptions opt;
+
+    for (int i = 0; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--rate") && hasValue) {
+            opt.rate = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--burst") && hasValue) {
+            opt.burst = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--over-limit") && hasValue) {
+            opt.shedExcess = !strcmp(argv[++i], "shed");
+        }
+        else if (!strcmp(argv[i], "--stale-after") && hasValue) {
+            if (!opt.staleness.parse(argv[++i])) {
+                cerr << "Bad --stale-after spec: " << argv[i] << '\n';
+                return 2;
+            }
+        }
+        else if (!strcmp(argv[i], "--dedup") && hasValue) {
+            opt.dedupSessions = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--idle-timeout") && hasValue) {
+            opt.idleTimeoutMs = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--workers") && hasValue) {
+            opt.workers = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "--coro")) {
+            opt.coro = true;
+        }
+        else if (!strcmp(argv[i], "--max-line") && hasValue) {
+            setMaxLine(strtoull(argv[++i], nullptr, 10));
+        }
+        else if (!strcmp(argv[i], "--vocab") && hasValue) {
+            string error;
+            if (!opt.vocabs.add(argv[++i], error)) {
+                cerr << "Cannot load vocabulary: " << error << '\n';
+                return 1;
+            }
+        }
+        else if (!opt.socketPath && argv[i][0] != '-') {
+            opt.socketPath = argv[i];
+        }
+        else {
+            opt.socketPath = nullptr;
+            break;
+        }
+    }
+
+    if (!opt.socketPath) {
+        cerr << "Usage: --server <socket-path> [--rate <per-sec>]"
+            " [--burst <n>] [--over-limit shed|defer] [--max-line <n>]"
+            " [--vocab <name>=<file>]... [--stale-after <spec>]"
+            " [--dedup <max-sessions>] [--idle-timeout <ms>]"
+            " [--workers <n>] [--coro]\n";
+        return 2;
+    }
+
+    // a line has to fit in the input buffer to reach its newline
+    opt.maxLine = maxLine() < MAX_PENDING_INPUT
+        ? maxLine() : MAX_PENDING_INPUT - 1;
+
+    // the coroutine pipeline has no admission control
+    if (opt.coro) {
+        if (opt.rate || opt.staleness.enabled() || opt.dedupSessions
+            || opt.idleTimeoutMs || opt.workers) {
+            cerr << "--rate, --stale-after, --dedup, --idle-timeout and"
+                " --workers are not supported with --coro\n";
+            return 2;
+        }
+        return runCoroServer(opt.socketPath, opt.vocabs, opt.maxLine);
+    }
+
+    // a retry may reach another worker, whose table never saw the
+    // first try, so exactly-once needs a single process
+    if (opt.workers && opt.dedupSessions) {
+        cerr << "--dedup is not supported with --workers\n";
+        return 2;
+    }
+
+    int listenFd = openListener(opt.socketPath);
+    if (listenFd < 0) {
+        return 1;
+    }
+
+    int result;
+    if (opt.workers) {
+        result = runPrefork(opt, listenFd);
+    }
+    else {
+        Server server(opt);
+        result = server.run(listenFd);
+        server.report();
+    }
+
+    close(listenFd);
+    unlink(opt.socketPath);
+    return result;
+}
+#else
+//------------------------------------------------------------------------------
+// - server mode needs POSIX sockets and poll()
+//------------------------------------------------------------------------------
+int serverMain(int, char*[]) {
+    cerr << "Server mode is not available on Windows\n";
+    return 1;
+}
+#endif
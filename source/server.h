@@ -0,0 +1,13 @@
+//----------------------------------------------------------------------
+// server.h
+//
+// Server mode: validates newline-separated commands from clients on
+// an AF_UNIX stream socket and answers each line with one line.
+//----------------------------------------------------------------------
+#pragma once
+
+//----------------------------------------------------------------------
+// - entry point for --server <socket-path> [options], see README.md
+// - returns the process exit code
+//----------------------------------------------------------------------
+int serverMain(int argc, char* argv[]);
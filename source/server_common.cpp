@@ -0,0 +1,118 @@
+//----------------------------------------------------------------------
+// server_common.cpp
+//----------------------------------------------------------------------
+#include "server_common.h"
+#include "line_reader.h"
+#include "sketches.h"
+#include "vocabulary.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::cerr;
+using std::shared_ptr;
+using std::string;
+
+#ifndef _WIN32
+int openListener(const char* path) {
+    sockaddr_un addr = {};
+    if (strlen(path) >= sizeof addr.sun_path) {
+        cerr << "Socket path too long: " << path << '\n';
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    unlink(path);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0
+        || listen(fd, SOMAXCONN) != 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+#else
+//------------------------------------------------------------------------------
+// - needs AF_UNIX sockets, see server.cpp
+//------------------------------------------------------------------------------
+int openListener(const char*) {
+    cerr << "Server mode is not available on this platform\n";
+    return -1;
+}
+#endif
+
+void appendAnswer(string& out, const char* line, size_t len, Command cmd) {
+    if (isAccepted(cmd)) {
+        out += commandName(cmd);
+    }
+    else {
+        out += cmd == CMD_BAD_STRING
+            ? "Bad string: " : "Unrecognized command exception: ";
+        out.append(line, len);
+    }
+    out += '\n';
+}
+
+void appendTooLong(string& out, const char* line, size_t len) {
+    size_t preview = len < TOO_LONG_PREVIEW ? len : TOO_LONG_PREVIEW;
+    if (sketchesEnabled()) {
+        rejectSketches().add(line, preview);
+    }
+    out += "Line too long: ";
+    out.append(line, preview);
+    out += "...\n";
+}
+
+void appendStats(string& out, const AdmissionCounters& mine,
+    const AdmissionCounters& total, uint64_t myStale, uint64_t totalStale) {
+
+    out += "admitted=" + std::to_string(mine.admitted)
+        + " shed=" + std::to_string(mine.shed)
+        + " deferred=" + std::to_string(mine.deferred)
+        + " stale=" + std::to_string(myStale)
+        + " total_admitted=" + std::to_string(total.admitted)
+        + " total_shed=" + std::to_string(total.shed)
+        + " total_deferred=" + std::to_string(total.deferred)
+        + " total_stale=" + std::to_string(totalStale) + '\n';
+}
+
+void bindVocabulary(string& out, const VocabularyRegistry& vocabs,
+    shared_ptr<const CompiledVocabulary>& vocab, const char* name,
+    size_t len) {
+
+    if (len == 0) {
+        vocab = nullptr;
+        out += "vocab default\n";
+        return;
+    }
+
+    string wanted(name, len);
+    shared_ptr<const CompiledVocabulary> found = vocabs.find(wanted);
+    if (!found) {
+        out += "Unknown vocabulary: " + wanted + '\n';
+        return;
+    }
+
+    vocab = std::move(found);
+    out += "vocab " + wanted + '\n';
+}
@@ -0,0 +1,53 @@
+//----------------------------------------------------------------------
+// server_common.h
+//
+// What the poll() server (server.cpp) and the coroutine server
+// (coro_server.cpp) have in common: the listening socket and the text
+// of every answer they send, so both give a client the same replies.
+//----------------------------------------------------------------------
+#pragma once
+
+#include "cmd_validate.h"
+#include "token_bucket.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class CompiledVocabulary;
+class VocabularyRegistry;
+
+//----------------------------------------------------------------------
+// - creates the AF_UNIX listening socket at path, non-blocking
+// - returns the fd, or -1 after printing why
+//----------------------------------------------------------------------
+int openListener(const char* path);
+
+//----------------------------------------------------------------------
+// - appends the answer for one validated line
+//----------------------------------------------------------------------
+void appendAnswer(std::string& out, const char* line, size_t len,
+    Command cmd);
+
+//----------------------------------------------------------------------
+// - appends the answer for a line over the length limit
+// - the preview goes into the reject sketches when they are enabled
+//----------------------------------------------------------------------
+void appendTooLong(std::string& out, const char* line, size_t len);
+
+//----------------------------------------------------------------------
+// - appends the "@stats" answer: one connection's counters, then the
+//   totals of the server
+//----------------------------------------------------------------------
+void appendStats(std::string& out, const AdmissionCounters& mine,
+    const AdmissionCounters& total, uint64_t myStale, uint64_t totalStale);
+
+//----------------------------------------------------------------------
+// - the "@vocab [name]" request: binds the named table, an empty name
+//   goes back to the built-in one, and appends the answer
+// - an unknown name leaves the binding as it was
+//----------------------------------------------------------------------
+void bindVocabulary(std::string& out, const VocabularyRegistry& vocabs,
+    std::shared_ptr<const CompiledVocabulary>& vocab, const char* name,
+    size_t len);
@@ -0,0 +1,354 @@
+//----------------------------------------------------------------------
+// sketches.cpp
+//
+// Space-Saving (Metwally et al.) and HyperLogLog (Flajolet et al.)
+// sketches for the rejected input strings.
+//
+// Only rejected lines reach these, so they can afford a string key
+// per new heavy hitter. Memory stays bounded by the top-K capacity
+// plus 16 KB of HyperLogLog registers.
+//----------------------------------------------------------------------
+#include "sketches.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::ostream;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+namespace {
+
+// saved sketch files start with this, followed by native-endian data
+const char SKETCH_MAGIC[4] = { 'R', 'S', 'K', '1' };
+
+//----------------------------------------------------------------------
+// - 64-bit FNV-1a, finished with the splitmix64 mixer so all bits
+//   are usable by HyperLogLog
+//----------------------------------------------------------------------
+uint64_t hashString(const char* str, size_t len) {
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= static_cast<unsigned char>(str[i]);
+        h *= 1099511628211ull;
+    }
+
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h;
+}
+
+template <typename T>
+bool writeValue(FILE* f, const T& value) {
+    return fwrite(&value, sizeof value, 1, f) == 1;
+}
+
+template <typename T>
+bool readValue(FILE* f, T& value) {
+    return fread(&value, sizeof value, 1, f) == 1;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// SpaceSaving
+//------------------------------------------------------------------------------
+SpaceSaving::SpaceSaving(size_t capacity) : cap(capacity ? capacity : 1) {
+    entries.reserve(cap);
+    index.reserve(cap);
+}
+
+//------------------------------------------------------------------------------
+// - counts one more occurrence of the passed string
+// - when full, the least counted key is replaced and its count is
+//   inherited as the new key's error
+//------------------------------------------------------------------------------
+void SpaceSaving::add(const char* str, size_t len, uint64_t weight) {
+    string key(str, std::min(len, MAX_KEY));
+
+    auto it = index.find(key);
+    if (it != index.end()) {
+        entries[it->second].count += weight;
+        return;
+    }
+
+    if (entries.size() < cap) {
+        index.emplace(key, entries.size());
+        entries.push_back({ std::move(key), weight, 0 });
+        return;
+    }
+
+    size_t m = minIndex();
+    Entry& victim = entries[m];
+    index.erase(victim.key);
+
+    uint64_t floor = victim.count;
+    victim.key = std::move(key);
+    victim.count = floor + weight;
+    victim.error = floor;
+    index.emplace(victim.key, m);
+}
+
+//------------------------------------------------------------------------------
+// - combines two summaries: a key missing from one side may have
+//   occurred there up to that side's minimum count
+//------------------------------------------------------------------------------
+void SpaceSaving::merge(const SpaceSaving& other) {
+    uint64_t minThis = entries.size() < cap ? 0 : entries[minIndex()].count;
+    uint64_t minOther = other.entries.size() < other.cap
+        ? 0 : other.entries[other.minIndex()].count;
+
+    unordered_map<string, Entry> combined;
+    for (const Entry& e : entries) {
+        combined[e.key] = e;
+    }
+    for (const Entry& e : other.entries) {
+        auto it = combined.find(e.key);
+        if (it != combined.end()) {
+            it->second.count += e.count;
+            it->second.error += e.error;
+        }
+        else {
+            combined[e.key] = { e.key, e.count + minThis, e.error + minThis };
+        }
+    }
+    for (const Entry& e : entries) {
+        if (!other.index.count(e.key)) {
+            combined[e.key].count += minOther;
+            combined[e.key].error += minOther;
+        }
+    }
+
+    entries.clear();
+    for (auto& kv : combined) {
+        entries.push_back(std::move(kv.second));
+    }
+    std::sort(entries.begin(), entries.end(),
+        [](const Entry& a, const Entry& b) { return a.count > b.count; });
+    if (entries.size() > cap) {
+        entries.resize(cap);
+    }
+    rebuildIndex();
+}
+
+vector<SpaceSaving::Entry> SpaceSaving::top() const {
+    vector<Entry> sorted = entries;
+    std::sort(sorted.begin(), sorted.end(),
+        [](const Entry& a, const Entry& b) { return a.count > b.count; });
+    return sorted;
+}
+
+size_t SpaceSaving::minIndex() const {
+    size_t m = 0;
+    for (size_t i = 1; i < entries.size(); ++i) {
+        if (entries[i].count < entries[m].count) {
+            m = i;
+        }
+    }
+    return m;
+}
+
+void SpaceSaving::rebuildIndex() {
+    index.clear();
+    for (size_t i = 0; i < entries.size(); ++i) {
+        index.emplace(entries[i].key, i);
+    }
+}
+
+bool SpaceSaving::save(FILE* f) const {
+    uint64_t capacity = cap;
+    uint64_t n = entries.size();
+    if (!writeValue(f, capacity) || !writeValue(f, n)) {
+        return false;
+    }
+
+    for (const Entry& e : entries) {
+        uint32_t len = static_cast<uint32_t>(e.key.size());
+        if (!writeValue(f, len)
+            || fwrite(e.key.data(), 1, len, f) != len
+            || !writeValue(f, e.count) || !writeValue(f, e.error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SpaceSaving::load(FILE* f) {
+    uint64_t capacity, n;
+    if (!readValue(f, capacity) || !readValue(f, n) || capacity == 0
+        || n > capacity) {
+        return false;
+    }
+
+    cap = static_cast<size_t>(capacity);
+    entries.clear();
+    for (uint64_t i = 0; i < n; ++i) {
+        uint32_t len;
+        if (!readValue(f, len) || len > MAX_KEY) {
+            return false;
+        }
+
+        Entry e;
+        e.key.resize(len);
+        if (fread(&e.key[0], 1, len, f) != len
+            || !readValue(f, e.count) || !readValue(f, e.error)) {
+            return false;
+        }
+        entries.push_back(std::move(e));
+    }
+
+    rebuildIndex();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// HyperLogLog
+//------------------------------------------------------------------------------
+void HyperLogLog::add(const char* str, size_t len) {
+    uint64_t h = hashString(str, len);
+    size_t reg = static_cast<size_t>(h >> (64 - PRECISION));
+
+    // rank = position of the first set bit in the remaining bits
+    uint64_t rest = h << PRECISION;
+    uint8_t rank = 1;
+    while (rank <= 64 - PRECISION && !(rest & (1ull << 63))) {
+        rest <<= 1;
+        ++rank;
+    }
+
+    if (rank > regs[reg]) {
+        regs[reg] = rank;
+    }
+}
+
+void HyperLogLog::merge(const HyperLogLog& other) {
+    for (size_t i = 0; i < REGISTERS; ++i) {
+        regs[i] = std::max(regs[i], other.regs[i]);
+    }
+}
+
+//------------------------------------------------------------------------------
+// - raw harmonic-mean estimate, with linear counting for small sets
+//------------------------------------------------------------------------------
+double HyperLogLog::estimate() const {
+    const double m = static_cast<double>(REGISTERS);
+
+    double sum = 0;
+    size_t zeros = 0;
+    for (uint8_t r : regs) {
+        sum += std::ldexp(1.0, -r);
+        zeros += r == 0;
+    }
+
+    double alpha = 0.7213 / (1 + 1.079 / m);
+    double e = alpha * m * m / sum;
+
+    if (e <= 2.5 * m && zeros != 0) {
+        e = m * std::log(m / zeros);
+    }
+    return e;
+}
+
+bool HyperLogLog::save(FILE* f) const {
+    return fwrite(regs.data(), 1, REGISTERS, f) == REGISTERS;
+}
+
+bool HyperLogLog::load(FILE* f) {
+    return fread(regs.data(), 1, REGISTERS, f) == REGISTERS;
+}
+
+//------------------------------------------------------------------------------
+// RejectSketches
+//------------------------------------------------------------------------------
+void RejectSketches::merge(const RejectSketches& other) {
+    topK.merge(other.topK);
+    distinct.merge(other.distinct);
+    total += other.total;
+}
+
+void RejectSketches::report(ostream& out, size_t limit) const {
+    out << "rejected lines: " << total
+        << ", distinct (estimate): "
+        << static_cast<uint64_t>(distinct.estimate() + 0.5) << '\n';
+
+    vector<SpaceSaving::Entry> entries = topK.top();
+    for (size_t i = 0; i < entries.size() && i < limit; ++i) {
+        const SpaceSaving::Entry& e = entries[i];
+        out << std::setw(12) << e.count << " (+/- " << e.error << ")  \""
+            << e.key << "\"\n";
+    }
+}
+
+bool RejectSketches::save(const char* path) const {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+
+    bool ok = fwrite(SKETCH_MAGIC, 1, 4, f) == 4 && writeValue(f, total)
+        && topK.save(f) && distinct.save(f);
+    return fclose(f) == 0 && ok;
+}
+
+bool RejectSketches::load(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+
+    char magic[4];
+    bool ok = fread(magic, 1, 4, f) == 4 && !memcmp(magic, SKETCH_MAGIC, 4)
+        && readValue(f, total) && topK.load(f) && distinct.load(f);
+    fclose(f);
+    return ok;
+}
+
+namespace {
+bool sketching = false;
+} // namespace
+
+void setSketchesEnabled(bool on) {
+    sketching = on;
+}
+
+bool sketchesEnabled() {
+    return sketching;
+}
+
+RejectSketches& rejectSketches() {
+    static RejectSketches sketches;
+    return sketches;
+}
+
+//------------------------------------------------------------------------------
+// - entry point for --sketch-report
+//------------------------------------------------------------------------------
+int sketchReportMain(int argc, char* argv[]) {
+    if (argc < 1) {
+        std::cerr << "Usage: --sketch-report <sketch-file>...\n";
+        return 2;
+    }
+
+    RejectSketches merged;
+    for (int i = 0; i < argc; ++i) {
+        RejectSketches one;
+        if (!one.load(argv[i])) {
+            std::cerr << "Cannot read sketch file " << argv[i] << '\n';
+            return 1;
+        }
+        merged.merge(one);
+    }
+
+    merged.report(std::cout, merged.topK.capacity());
+    return 0;
+}
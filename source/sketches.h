@@ -0,0 +1,122 @@
+//----------------------------------------------------------------------
+// sketches.h
+//
+// Bounded-memory summaries of the rejected input strings:
+//
+// - SpaceSaving keeps the K most frequent strings with counts that
+//   are never too low and at most `error` too high
+// - HyperLogLog estimates how many distinct strings were seen
+//
+// Both merge, so each thread or input file can keep its own sketch
+// and the results can be combined afterwards.
+//----------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//----------------------------------------------------------------------
+// SpaceSaving : top-K heavy hitters
+//----------------------------------------------------------------------
+class SpaceSaving {
+public:
+    // longest key kept, longer strings are truncated to bound memory
+    static constexpr size_t MAX_KEY = 64;
+
+    struct Entry {
+        std::string key;
+        uint64_t count;
+        uint64_t error;     // count may be over by at most this much
+    };
+
+    explicit SpaceSaving(size_t capacity = 64);
+
+    void add(const char* str, size_t len, uint64_t weight = 1);
+
+    // mergeable summaries: the result bounds the combined stream
+    void merge(const SpaceSaving& other);
+
+    // entries sorted by count, highest first
+    std::vector<Entry> top() const;
+
+    size_t capacity() const { return cap; }
+
+    bool save(FILE* f) const;
+    bool load(FILE* f);
+
+private:
+    size_t cap;
+    std::vector<Entry> entries;
+    std::unordered_map<std::string, size_t> index;
+
+    size_t minIndex() const;
+    void rebuildIndex();
+};
+
+//----------------------------------------------------------------------
+// HyperLogLog : distinct-count estimate, 2^PRECISION one-byte registers
+//----------------------------------------------------------------------
+class HyperLogLog {
+public:
+    static constexpr int PRECISION = 14;
+    static constexpr size_t REGISTERS = size_t(1) << PRECISION;
+
+    HyperLogLog() : regs(REGISTERS, 0) {}
+
+    void add(const char* str, size_t len);
+
+    // register-wise max, the union of both streams
+    void merge(const HyperLogLog& other);
+
+    double estimate() const;
+
+    bool save(FILE* f) const;
+    bool load(FILE* f);
+
+private:
+    std::vector<uint8_t> regs;
+};
+
+//----------------------------------------------------------------------
+// RejectSketches : both sketches, fed with every rejected input line
+//----------------------------------------------------------------------
+struct RejectSketches {
+    SpaceSaving topK;
+    HyperLogLog distinct;
+    uint64_t total = 0;
+
+    void add(const char* str, size_t len) {
+        topK.add(str, len);
+        distinct.add(str, len);
+        ++total;
+    }
+    void add(const std::string& str) { add(str.data(), str.size()); }
+
+    void merge(const RejectSketches& other);
+
+    // prints the distinct estimate and the top `limit` strings
+    void report(std::ostream& out, size_t limit = 10) const;
+
+    bool save(const char* path) const;
+    bool load(const char* path);
+};
+
+// process-wide sketches fed by the modes that see rejected lines
+RejectSketches& rejectSketches();
+
+// - true once --sketch-out asked for the sketches to be saved
+// - callers check it before rejectSketches().add(), so rejected
+//   lines cost nothing extra when no one will read the sketches
+void setSketchesEnabled(bool on);
+bool sketchesEnabled();
+
+//----------------------------------------------------------------------
+// - entry point for --sketch-report <file>...
+// - merges saved sketches and prints the combined report
+//----------------------------------------------------------------------
+int sketchReportMain(int argc, char* argv[]);
@@ -0,0 +1,104 @@
+//----------------------------------------------------------------------
+// staleness.cpp
+//
+// Parsing of --stale-after and the first-letter opcode prediction.
+//----------------------------------------------------------------------
+#include "staleness.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#define strncasecmp _strnicmp
+#else
+#include <strings.h>
+#endif
+
+bool StalenessPolicy::parse(const char* spec) {
+    uint64_t parsed[CMD_NUM_COMMANDS + 1] = {};
+
+    // a bare number sets every deadline
+    char* end;
+    uint64_t ms = strtoull(spec, &end, 10);
+    if (end != spec && !*end) {
+        for (uint64_t& d : parsed) {
+            d = ms * 1000;
+        }
+    }
+    else {
+        for (const char* p = spec; *p;) {
+            const char* eq = strchr(p, '=');
+            if (!eq) {
+                return false;
+            }
+
+            size_t nameLen = eq - p;
+            int slot = 0;
+            while (slot < CMD_NUM_COMMANDS
+                && !(strlen(commandName(static_cast<Command>(slot))) == nameLen
+                    && !strncasecmp(p,
+                        commandName(static_cast<Command>(slot)), nameLen))) {
+                ++slot;
+            }
+            if (slot == CMD_NUM_COMMANDS
+                && !(nameLen == 7 && !strncmp(p, "default", 7))) {
+                return false;
+            }
+
+            ms = strtoull(eq + 1, &end, 10);
+            if (end == eq + 1 || (*end && *end != ',')) {
+                return false;
+            }
+            parsed[slot] = ms * 1000;
+            p = *end ? end + 1 : end;
+        }
+    }
+
+    memcpy(deadlineUs, parsed, sizeof deadlineUs);
+    on = false;
+    for (uint64_t d : deadlineUs) {
+        on = on || d != 0;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// - matchCommand() on a lowercased line decides by the first letter
+//   alone, so this is exact for every line the built-in rules accept
+// - tenant vocabulary and multibyte localized words are not covered,
+//   callers classify those lines fully
+//------------------------------------------------------------------------------
+Command StalenessPolicy::predict(const char* str, size_t len) {
+    if (len == 0) {
+        return CMD_UNRECOGNIZED;
+    }
+
+    switch (str[0] | 0x20) {
+    case 'p': return CMD_PLAY;
+    case 'a': return CMD_PAUSE;
+    case 'r': return CMD_REWIND;
+    case 'f': return CMD_FAST_FORWARD;
+    case 's': return CMD_STOP;
+    case 'q': return CMD_QUIT;
+    default:  return CMD_UNRECOGNIZED;
+    }
+}
+
+std::string StaleCounters::format() const {
+    std::string out = "stale=" + std::to_string(total);
+
+    bool any = false;
+    for (int i = 0; i <= CMD_NUM_COMMANDS; ++i) {
+        if (byCommand[i]) {
+            out += any ? " " : " (";
+            out += i < CMD_NUM_COMMANDS
+                ? commandName(static_cast<Command>(i)) : "other";
+            out += '=' + std::to_string(byCommand[i]);
+            any = true;
+        }
+    }
+    if (any) {
+        out += ')';
+    }
+    return out;
+}
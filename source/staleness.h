@@ -0,0 +1,69 @@
+//----------------------------------------------------------------------
+// staleness.h
+//
+// Age-based load shedding. A command that waited longer than the
+// deadline for its opcode is answered "Stale" and dropped before any
+// validation work, so a backlog after a burst drains quickly instead
+// of replaying minutes-old "play"s and "pause"s.
+//
+// A line's age counts from its t=<ms> envelope field (Unix epoch, see
+// envelope.h) when it has one, else from when its newline was read.
+//
+// The opcode comes from the first letter, the same way matchCommand()
+// picks it, so no validation runs for a dropped line. Lines without a
+// known first letter use the default deadline. The first letter says
+// nothing about tenant vocabulary or localized words, so the server
+// looks those lines up in full, and it never drops quit or "@" lines.
+//----------------------------------------------------------------------
+#pragma once
+
+#include "cmd_validate.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//----------------------------------------------------------------------
+// StalenessPolicy : deadline per opcode, 0 = never stale
+//----------------------------------------------------------------------
+class StalenessPolicy {
+public:
+    // - parses "<ms>" for every opcode, or a list like
+    //   "play=200,pause=200,stop=0,default=1000"
+    // - opcode names are those of commandName(), in any case
+    // - returns false on a bad spec
+    bool parse(const char* spec);
+
+    bool enabled() const { return on; }
+
+    // - the opcode a line will get if the built-in rules accept it
+    // - CMD_UNRECOGNIZED if the first letter names none
+    static Command predict(const char* str, size_t len);
+
+    // true if a line predicted as cmd is older than its deadline
+    bool isStale(Command cmd, uint64_t ageUs) const {
+        uint64_t deadline = deadlineUs[isAccepted(cmd) ? cmd : CMD_NUM_COMMANDS];
+        return deadline && ageUs > deadline;
+    }
+
+private:
+    // one per opcode, then the default
+    uint64_t deadlineUs[CMD_NUM_COMMANDS + 1] = {};
+    bool on = false;
+};
+
+//----------------------------------------------------------------------
+// StaleCounters : lines dropped as stale, by predicted opcode
+//----------------------------------------------------------------------
+struct StaleCounters {
+    uint64_t byCommand[CMD_NUM_COMMANDS + 1] = {};   // last: unknown
+    uint64_t total = 0;
+
+    void add(Command cmd) {
+        ++byCommand[isAccepted(cmd) ? cmd : CMD_NUM_COMMANDS];
+        ++total;
+    }
+
+    // "stale=<total> (play=<n> ...)" with the non-zero ones
+    std::string format() const;
+};
@@ -0,0 +1,139 @@
+//----------------------------------------------------------------------
+// timer_wheel.cpp
+//
+// Slot of a timer at level L: bits [L * SLOT_BITS, (L + 1) * SLOT_BITS)
+// of its expiry tick. A level-L slot is cascaded when all the bits
+// below it in the clock are zero, i.e. when the level below wraps.
+//----------------------------------------------------------------------
+#include "timer_wheel.h"
+
+#include <bit>
+
+TimerWheel::TimerWheel(uint64_t now) : current(now) {
+    for (auto& level : slots) {
+        for (TimerNode& head : level) {
+            head.prev = head.next = &head;
+        }
+    }
+}
+
+void TimerWheel::schedule(TimerNode& node, uint64_t expiry) {
+    if (node.scheduled()) {
+        unlink(node);
+    }
+    node.expiry = expiry;
+    // the slot for the current tick has been done already
+    place(node, current + 1);
+}
+
+void TimerWheel::cancel(TimerNode& node) {
+    if (node.scheduled()) {
+        unlink(node);
+    }
+}
+
+//------------------------------------------------------------------------------
+// - puts the node on the lowest level whose turn reaches its expiry,
+//   or `earliest` if that is later
+// - beyond the top level it waits in the top level's farthest slot
+//------------------------------------------------------------------------------
+void TimerWheel::place(TimerNode& node, uint64_t earliest) {
+    uint64_t expiry = node.expiry > earliest ? node.expiry : earliest;
+    uint64_t delta = expiry - current;
+
+    unsigned level = 0;
+    while (level + 1 < LEVELS && delta >= uint64_t(1) << (SLOT_BITS * (level + 1))) {
+        ++level;
+    }
+
+    uint64_t span = uint64_t(1) << (SLOT_BITS * LEVELS);
+    if (delta >= span) {
+        expiry = current + span - 1;
+    }
+
+    unsigned slot = static_cast<unsigned>(
+        expiry >> (SLOT_BITS * level) & (SLOTS - 1));
+    TimerNode& head = slots[level][slot];
+
+    node.prev = head.prev;
+    node.next = &head;
+    head.prev->next = &node;
+    head.prev = &node;
+
+    occupied[level] |= uint64_t(1) << slot;
+    ++count;
+}
+
+void TimerWheel::unlink(TimerNode& node) {
+    node.prev->next = node.next;
+    node.next->prev = node.prev;
+
+    // a sentinel pointing at itself means the slot is now empty
+    if (node.next == node.prev && node.next->next == node.next) {
+        TimerNode* head = node.next;
+        for (unsigned level = 0; level < LEVELS; ++level) {
+            if (head >= slots[level] && head < slots[level] + SLOTS) {
+                occupied[level] &= ~(uint64_t(1) << (head - slots[level]));
+            }
+        }
+    }
+
+    node.prev = node.next = nullptr;
+    --count;
+}
+
+void TimerWheel::moveSlot(unsigned level, unsigned slot, TimerNode& into) {
+    TimerNode& head = slots[level][slot];
+    if (head.next == &head) {
+        return;
+    }
+
+    into.next = head.next;
+    into.prev = head.prev;
+    into.next->prev = &into;
+    into.prev->next = &into;
+
+    head.prev = head.next = &head;
+    occupied[level] &= ~(uint64_t(1) << slot);
+}
+
+//------------------------------------------------------------------------------
+// - re-places every timer of the level's current slot one level down,
+//   cascading the level above first if this level wrapped too
+//------------------------------------------------------------------------------
+void TimerWheel::cascade(unsigned level) {
+    if (level >= LEVELS) {
+        return;
+    }
+
+    unsigned slot = static_cast<unsigned>(
+        current >> (SLOT_BITS * level) & (SLOTS - 1));
+    if (slot == 0) {
+        cascade(level + 1);
+    }
+
+    TimerNode moving;
+    moving.prev = moving.next = &moving;
+    moveSlot(level, slot, moving);
+
+    // due this very tick is fine, its level 0 slot comes next
+    while (moving.next != &moving) {
+        TimerNode& node = *moving.next;
+        unlink(node);
+        place(node, current);
+    }
+}
+
+uint64_t TimerWheel::ticksUntilNext() const {
+    if (count == 0) {
+        return UINT64_MAX;
+    }
+
+    // slots after the current one on level 0, before it wraps
+    unsigned pos = static_cast<unsigned>(current & (SLOTS - 1));
+    uint64_t ahead = pos + 1 < SLOTS ? occupied[0] >> (pos + 1) : 0;
+    if (ahead) {
+        return static_cast<uint64_t>(std::countr_zero(ahead)) + 1;
+    }
+    return SLOTS - pos;
+}
@@ -0,0 +1,108 @@
+//----------------------------------------------------------------------
+// timer_wheel.h
+//
+// Hierarchical timing wheel (Varghese & Lauck) for session idle
+// expiry: LEVELS wheels of SLOTS slots, each level's slot spanning a
+// whole turn of the level below. A timer sits in the slot for its
+// expiry on the lowest level whose turn reaches it; when a lower
+// wheel wraps, the next slot of the level above is cascaded down.
+//
+// Timers are intrusive list nodes, so schedule, reschedule and cancel
+// are O(1) pointer updates with no allocation, and expiring a timer is
+// O(1) plus at most LEVELS - 1 cascades over its lifetime.
+//----------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//----------------------------------------------------------------------
+// TimerNode : embed one in whatever can expire
+//----------------------------------------------------------------------
+struct TimerNode {
+    TimerNode* prev = nullptr;
+    TimerNode* next = nullptr;
+    uint64_t expiry = 0;            // in wheel ticks
+    uint64_t key = 0;               // for the owner, e.g. a session id
+
+    bool scheduled() const { return prev != nullptr; }
+};
+
+//----------------------------------------------------------------------
+// TimerWheel : timers on a tick clock the caller advances
+//----------------------------------------------------------------------
+class TimerWheel {
+public:
+    static constexpr unsigned SLOT_BITS = 6;
+    static constexpr unsigned SLOTS = 1u << SLOT_BITS;
+    static constexpr unsigned LEVELS = 4;
+
+    explicit TimerWheel(uint64_t now = 0);
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // - (re)schedules the node to expire at the given tick
+    // - a tick already past expires on the next advance()
+    void schedule(TimerNode& node, uint64_t expiry);
+
+    void cancel(TimerNode& node);
+
+    // - moves the clock to `now`, calling onExpire(node) for every
+    //   timer due by then, after unlinking it
+    template <typename F>
+    void advance(uint64_t now, F onExpire);
+
+    // - ticks until the next slot on the lowest wheel that has timers,
+    //   or until that wheel wraps; UINT64_MAX with no timers
+    uint64_t ticksUntilNext() const;
+
+    size_t size() const { return count; }
+    uint64_t now() const { return current; }
+
+private:
+    // sentinel heads of circular lists, so unlinking needs no checks
+    TimerNode slots[LEVELS][SLOTS];
+    uint64_t occupied[LEVELS] = {};     // bit per non-empty slot
+    uint64_t current;
+    size_t count = 0;
+
+    void place(TimerNode& node, uint64_t earliest);
+    void unlink(TimerNode& node);
+    void cascade(unsigned level);
+
+    // - moves a slot's whole list behind the empty sentinel `into`, so
+    //   its timers stay linked and cancellable while we go through it
+    void moveSlot(unsigned level, unsigned slot, TimerNode& into);
+};
+
+template <typename F>
+void TimerWheel::advance(uint64_t now, F onExpire) {
+    while (current < now) {
+        // nothing to find on the way, jump straight there
+        if (count == 0) {
+            current = now;
+            return;
+        }
+
+        ++current;
+        if ((current & (SLOTS - 1)) == 0) {
+            cascade(1);
+        }
+
+        TimerNode due;
+        due.prev = due.next = &due;
+        moveSlot(0, current & (SLOTS - 1), due);
+
+        while (due.next != &due) {
+            TimerNode& node = *due.next;
+            unlink(node);
+            // clamped to the top level, so not due yet
+            if (node.expiry > current) {
+                schedule(node, node.expiry);
+            }
+            else {
+                onExpire(node);
+            }
+        }
+    }
+}
@@ -0,0 +1,80 @@
+//----------------------------------------------------------------------
+// token_bucket.h
+//
+// Token bucket rate limiter for admission control.
+//
+// The bucket holds up to `burst` tokens and refills at `rate` tokens
+// per second. Each admitted command takes one token. Tokens are kept
+// in millionths so refilling needs only integer math.
+//----------------------------------------------------------------------
+#pragma once
+
+#include <cstdint>
+
+//----------------------------------------------------------------------
+// TokenBucket : rate 0 means unlimited
+//----------------------------------------------------------------------
+class TokenBucket {
+public:
+    static constexpr uint64_t SCALE = 1000000;
+
+    TokenBucket(uint64_t ratePerSec = 0, uint64_t burst = 1)
+        : rate(ratePerSec), capacity((burst ? burst : 1) * SCALE),
+          tokens(capacity) {}
+
+    // - takes one token if there is one
+    // - nowUs is a monotonic time in microseconds
+    bool take(uint64_t nowUs) {
+        if (rate == 0) {
+            return true;
+        }
+
+        refill(nowUs);
+        if (tokens < SCALE) {
+            return false;
+        }
+        tokens -= SCALE;
+        return true;
+    }
+
+    // microseconds until the next token, 0 if one is available now
+    uint64_t waitUs(uint64_t nowUs) {
+        if (rate == 0) {
+            return 0;
+        }
+
+        refill(nowUs);
+        if (tokens >= SCALE) {
+            return 0;
+        }
+        return (SCALE - tokens + rate - 1) / rate;
+    }
+
+private:
+    uint64_t rate;
+    uint64_t capacity;
+    uint64_t tokens;
+    uint64_t lastUs = 0;
+
+    // one token per second per unit of rate is SCALE millionths per
+    // second, which is `rate` millionths per microsecond
+    void refill(uint64_t nowUs) {
+        if (lastUs == 0 || nowUs < lastUs) {
+            lastUs = nowUs;
+            return;
+        }
+
+        uint64_t add = (nowUs - lastUs) * rate;
+        tokens = add >= capacity - tokens ? capacity : tokens + add;
+        lastUs = nowUs;
+    }
+};
+
+//----------------------------------------------------------------------
+// AdmissionCounters : what the limiter did, for tuning the limits
+//----------------------------------------------------------------------
+struct AdmissionCounters {
+    uint64_t admitted = 0;
+    uint64_t shed = 0;          // answered "Rate limited" unvalidated
+    uint64_t deferred = 0;      // times a connection was paused
+};
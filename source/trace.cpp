@@ -0,0 +1,142 @@
+//----------------------------------------------------------------------
+// trace.cpp
+//
+// Per-thread trace rings and the Chrome trace JSON writer.
+//
+// Each thread owns one ring and is its only writer. The writer stores
+// an event, then publishes it by bumping the ring's head with release
+// order; the dump at exit reads the head with acquire order. A ring
+// keeps only its newest RING_EVENTS events, older ones are overwritten.
+//
+// Rings are never freed, so a thread that exits before the dump still
+// has its events written.
+//----------------------------------------------------------------------
+#ifdef CMD_TRACE
+
+#include "trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+constexpr size_t RING_EVENTS = 1 << 16;
+
+// marks an instant event
+constexpr uint64_t INSTANT = UINT64_MAX;
+
+struct TraceEvent {
+    const char* name;
+    uint64_t startNs;
+    uint64_t durNs;
+};
+
+struct TraceRing {
+    TraceEvent events[RING_EVENTS];
+    std::atomic<uint64_t> head{ 0 };
+    unsigned tid = 0;
+};
+
+std::mutex ringsMutex;                  // only taken to add a ring
+std::vector<TraceRing*> rings;
+const char* outputPath = nullptr;
+
+uint64_t nowNs() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(
+        steady_clock::now().time_since_epoch()).count();
+}
+
+// start of the trace, so timestamps stay small
+const uint64_t originNs = nowNs();
+
+void writeTrace();
+
+TraceRing* registerRing() {
+    TraceRing* ring = new TraceRing;
+
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    if (rings.empty()) {
+        atexit(writeTrace);
+    }
+    ring->tid = static_cast<unsigned>(rings.size() + 1);
+    rings.push_back(ring);
+    return ring;
+}
+
+void record(const char* name, uint64_t startNs, uint64_t durNs) {
+    thread_local TraceRing* ring = registerRing();
+
+    uint64_t h = ring->head.load(std::memory_order_relaxed);
+    ring->events[h % RING_EVENTS] = { name, startNs, durNs };
+    ring->head.store(h + 1, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------
+// - writes the newest events of every ring as Chrome trace JSON
+// - timestamps are in microseconds since the trace started
+//----------------------------------------------------------------------
+void writeTrace() {
+    if (!outputPath) {
+        return;
+    }
+
+    FILE* f = fopen(outputPath, "w");
+    if (!f) {
+        fprintf(stderr, "Cannot write trace file %s\n", outputPath);
+        return;
+    }
+
+    fputs("{\"traceEvents\":[\n", f);
+    bool first = true;
+
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    for (TraceRing* ring : rings) {
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t begin = head > RING_EVENTS ? head - RING_EVENTS : 0;
+
+        for (uint64_t i = begin; i < head; ++i) {
+            const TraceEvent& e = ring->events[i % RING_EVENTS];
+            double ts = (e.startNs - originNs) / 1000.0;
+
+            fprintf(f, "%s{\"name\":\"%s\",\"pid\":1,\"tid\":%u,\"ts\":%.3f",
+                first ? "" : ",\n", e.name, ring->tid, ts);
+            if (e.durNs == INSTANT) {
+                fputs(",\"ph\":\"i\",\"s\":\"t\"}", f);
+            }
+            else {
+                fprintf(f, ",\"ph\":\"X\",\"dur\":%.3f}", e.durNs / 1000.0);
+            }
+            first = false;
+        }
+    }
+
+    fputs("\n]}\n", f);
+    fclose(f);
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// TraceScope
+//------------------------------------------------------------------------------
+TraceScope::TraceScope(const char* name) : name(name), startNs(nowNs()) {
+}
+
+TraceScope::~TraceScope() {
+    record(name, startNs, nowNs() - startNs);
+}
+
+void traceInstant(const char* name) {
+    record(name, nowNs(), INSTANT);
+}
+
+void traceSetOutput(const char* path) {
+    outputPath = path;
+}
+
+#endif // CMD_TRACE
@@ -0,0 +1,55 @@
+//----------------------------------------------------------------------
+// trace.h
+//
+// Trace points for builds with CMD_TRACE defined.
+//
+// TRACE_SCOPE records how long the rest of the enclosing block takes,
+// TRACE_INSTANT records a point in time. Events go to a ring buffer
+// owned by the recording thread, so recording takes no lock, and the
+// newest events of every thread are written out as Chrome trace JSON
+// at exit (load the file in chrome://tracing or Perfetto).
+//
+// Without CMD_TRACE the macros compile to nothing.
+//----------------------------------------------------------------------
+#pragma once
+
+#ifdef CMD_TRACE
+
+#include <cstdint>
+
+//----------------------------------------------------------------------
+// TraceScope : records a complete event from construction to exit
+//----------------------------------------------------------------------
+class TraceScope {
+public:
+    explicit TraceScope(const char* name);
+    ~TraceScope();
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+    uint64_t startNs;
+};
+
+// records an instant event, name must be a string literal
+void traceInstant(const char* name);
+
+// - sets the file the trace is written to at exit
+// - without a call, nothing is written
+void traceSetOutput(const char* path);
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define TRACE_INSTANT(name) traceInstant(name)
+
+#else
+
+inline void traceSetOutput(const char*) {}
+
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_INSTANT(name) ((void)0)
+
+#endif
@@ -0,0 +1,94 @@
+//----------------------------------------------------------------------
+// validator.cpp
+//
+// Policy implementations and the explicit instantiations of the
+// deployed Validator configurations.
+//----------------------------------------------------------------------
+#include "validator.h"
+
+namespace {
+
+// full command names, indexed by opcode
+const char* const NAMES[CMD_NUM_COMMANDS] = {
+    "play", "pause", "rewind", "fast-forward", "stop", "quit"
+};
+
+// menu letters, indexed by opcode
+const char LETTERS[CMD_NUM_COMMANDS + 1] = "parfsq";
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// FirstLetter
+//------------------------------------------------------------------------------
+template <typename CaseFold>
+Command FirstLetter::match(const char* str, size_t len) {
+    if (len == 0) {
+        return CMD_UNRECOGNIZED;
+    }
+
+    switch (CaseFold::fold(str[0])) {
+    case 'p': return CMD_PLAY;
+    case 'a': return CMD_PAUSE;
+    case 'r': return CMD_REWIND;
+    case 'f': return CMD_FAST_FORWARD;
+    case 's': return CMD_STOP;
+    case 'q': return CMD_QUIT;
+    }
+    return CMD_UNRECOGNIZED;
+}
+
+//------------------------------------------------------------------------------
+// ExactName
+//------------------------------------------------------------------------------
+template <typename CaseFold>
+Command ExactName::match(const char* str, size_t len) {
+    for (int cmd = 0; cmd < CMD_NUM_COMMANDS; ++cmd) {
+        const char* name = NAMES[cmd];
+
+        size_t i = 0;
+        while (i < len && name[i] && CaseFold::fold(str[i]) == name[i]) {
+            ++i;
+        }
+        if (i == len && name[i] == '\0') {
+            return static_cast<Command>(cmd);
+        }
+    }
+    return CMD_UNRECOGNIZED;
+}
+
+//------------------------------------------------------------------------------
+// NameOrLetter
+//------------------------------------------------------------------------------
+template <typename CaseFold>
+Command NameOrLetter::match(const char* str, size_t len) {
+    if (len == 1) {
+        char c = CaseFold::fold(str[0]);
+        for (int cmd = 0; cmd < CMD_NUM_COMMANDS; ++cmd) {
+            if (c == LETTERS[cmd]) {
+                return static_cast<Command>(cmd);
+            }
+        }
+        return CMD_UNRECOGNIZED;
+    }
+    return ExactName::match<CaseFold>(str, len);
+}
+
+//------------------------------------------------------------------------------
+// Validator
+//------------------------------------------------------------------------------
+template <typename CaseFold, typename MatchPolicy, typename CharClass>
+Command Validator<CaseFold, MatchPolicy, CharClass>::classify(
+    const char* str, size_t len) {
+
+    for (size_t i = 0; i < len; ++i) {
+        if (!CharClass::allowed(str[i])) {
+            return CMD_BAD_STRING;
+        }
+    }
+    return MatchPolicy::template match<CaseFold>(str, len);
+}
+
+template class Validator<FoldCase, FirstLetter, AlphaDash>;
+template class Validator<KeepCase, ExactName, AlphaDash>;
+template class Validator<FoldCase, NameOrLetter, AlphaDashDigit>;
@@ -0,0 +1,96 @@
+//----------------------------------------------------------------------
+// validator.h
+//
+// Validator<CaseFold, MatchPolicy, CharClass> builds a classifier from
+// three policies, so a deployment's choices are made at compile time
+// and the code for the other choices is not in its instantiation.
+//
+//     CaseFold      FoldCase, KeepCase
+//     MatchPolicy   FirstLetter, ExactName, NameOrLetter
+//     CharClass     AlphaDash, AlphaDashDigit
+//
+// The three configurations we deploy are instantiated once, in
+// validator.cpp, and registered as lookup engines (see engines.h).
+//----------------------------------------------------------------------
+#pragma once
+
+#include "cmd_validate.h"
+
+#include <cstddef>
+
+//----------------------------------------------------------------------
+// case folding policies
+//----------------------------------------------------------------------
+struct FoldCase {
+    static char fold(char c) {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c + 0x20) : c;
+    }
+};
+
+struct KeepCase {
+    static char fold(char c) { return c; }
+};
+
+//----------------------------------------------------------------------
+// character class policies
+//----------------------------------------------------------------------
+struct AlphaDash {
+    static bool allowed(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '-';
+    }
+};
+
+struct AlphaDashDigit {
+    static bool allowed(char c) {
+        return AlphaDash::allowed(c) || (c >= '0' && c <= '9');
+    }
+};
+
+//----------------------------------------------------------------------
+// matching policies, on a line that passed the character class
+//----------------------------------------------------------------------
+
+// the first letter decides, as in validateCommand()
+struct FirstLetter {
+    template <typename CaseFold>
+    static Command match(const char* str, size_t len);
+};
+
+// only the full command names
+struct ExactName {
+    template <typename CaseFold>
+    static Command match(const char* str, size_t len);
+};
+
+// the full command names or their menu letters (p, a, r, f, s, q)
+struct NameOrLetter {
+    template <typename CaseFold>
+    static Command match(const char* str, size_t len);
+};
+
+//----------------------------------------------------------------------
+// Validator : classifies raw lines with the chosen policies
+//----------------------------------------------------------------------
+template <typename CaseFold, typename MatchPolicy, typename CharClass>
+class Validator {
+public:
+    // same contract as classifyCommand()
+    static Command classify(const char* str, size_t len);
+};
+
+//----------------------------------------------------------------------
+// the deployed configurations
+//----------------------------------------------------------------------
+
+// today's rules: any case, first letter, [A-Za-z-]
+using ClassicValidator = Validator<FoldCase, FirstLetter, AlphaDash>;
+
+// lowercase full names only
+using StrictValidator = Validator<KeepCase, ExactName, AlphaDash>;
+
+// any case, full names or menu letters, digits allowed but unmatched
+using AbbrevValidator = Validator<FoldCase, NameOrLetter, AlphaDashDigit>;
+
+extern template class Validator<FoldCase, FirstLetter, AlphaDash>;
+extern template class Validator<KeepCase, ExactName, AlphaDash>;
+extern template class Validator<FoldCase, NameOrLetter, AlphaDashDigit>;
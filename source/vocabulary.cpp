@@ -0,0 +1,216 @@
+//----------------------------------------------------------------------
+// vocabulary.cpp
+//
+// Loading, compiling and looking up tenant vocabularies.
+//----------------------------------------------------------------------
+#include "vocabulary.h"
+#include "engines.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::shared_ptr;
+using std::string;
+
+namespace {
+
+// longest word a vocabulary may hold
+constexpr size_t MAX_WORD = 255;
+
+// command names a vocabulary file may map words to
+const char* const TARGETS[CMD_NUM_COMMANDS] = {
+    "play", "pause", "rewind", "fast-forward", "stop", "quit"
+};
+
+char foldAscii(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c + 0x20) : c;
+}
+
+// - FNV-1a over the ASCII-folded bytes
+uint64_t hashFolded(const char* str, size_t len) {
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= static_cast<unsigned char>(foldAscii(str[i]));
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// CompiledVocabulary
+//------------------------------------------------------------------------------
+shared_ptr<const CompiledVocabulary> CompiledVocabulary::load(
+    const char* path, string& error) {
+
+    std::ifstream in(path);
+    if (!in) {
+        error = string("cannot read ") + path;
+        return nullptr;
+    }
+
+    // collect first, so the table can be sized once
+    std::vector<std::pair<string, Command>> entries;
+    bool useFallback = true;
+
+    string line;
+    for (int lineNo = 1; getline(in, line); ++lineNo) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        string word, target;
+        if (!(fields >> word >> target) || word.size() > MAX_WORD) {
+            error = string(path) + ":" + std::to_string(lineNo)
+                + ": expected \"<word> <command>\"";
+            return nullptr;
+        }
+
+        if (word == "fallback") {
+            useFallback = target != "off";
+            continue;
+        }
+
+        int cmd = 0;
+        while (cmd < CMD_NUM_COMMANDS && target != TARGETS[cmd]) {
+            ++cmd;
+        }
+        if (cmd == CMD_NUM_COMMANDS) {
+            error = string(path) + ":" + std::to_string(lineNo)
+                + ": unknown command " + target;
+            return nullptr;
+        }
+
+        for (char& c : word) {
+            c = foldAscii(c);
+        }
+        entries.emplace_back(word, static_cast<Command>(cmd));
+    }
+
+    // at most half full keeps probe sequences short
+    size_t size = 8;
+    while (size < entries.size() * 2) {
+        size *= 2;
+    }
+
+    auto vocab = std::make_shared<CompiledVocabulary>();
+    vocab->slots.assign(size, Slot{ 0, 0, 0 });
+    vocab->useFallback = useFallback;
+    for (const auto& e : entries) {
+        if (!vocab->insert(e.first, e.second)) {
+            error = string(path) + ": duplicate word " + e.first;
+            return nullptr;
+        }
+    }
+    vocab->arena.shrink_to_fit();
+    return vocab;
+}
+
+bool CompiledVocabulary::insert(const string& folded, Command cmd) {
+    size_t mask = slots.size() - 1;
+    size_t i = hashFolded(folded.data(), folded.size()) & mask;
+
+    while (slots[i].len) {
+        if (slots[i].len == folded.size()
+            && !arena.compare(slots[i].offset, folded.size(), folded)) {
+            return false;
+        }
+        i = (i + 1) & mask;
+    }
+
+    slots[i] = { static_cast<uint32_t>(arena.size()),
+        static_cast<uint16_t>(folded.size()), static_cast<uint8_t>(cmd) };
+    arena += folded;
+    ++wordCount;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// - linear probing; an empty slot ends the search
+//------------------------------------------------------------------------------
+bool CompiledVocabulary::lookup(const char* str, size_t len,
+    Command& cmd) const {
+
+    if (len == 0 || len > MAX_WORD) {
+        return false;
+    }
+
+    size_t mask = slots.size() - 1;
+    for (size_t i = hashFolded(str, len) & mask; slots[i].len;
+        i = (i + 1) & mask) {
+
+        const Slot& s = slots[i];
+        if (s.len != len) {
+            continue;
+        }
+
+        const char* word = arena.data() + s.offset;
+        size_t k = 0;
+        while (k < len && foldAscii(str[k]) == word[k]) {
+            ++k;
+        }
+        if (k == len) {
+            cmd = static_cast<Command>(s.cmd);
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t CompiledVocabulary::memoryBytes() const {
+    return sizeof *this + slots.capacity() * sizeof(Slot) + arena.capacity();
+}
+
+//------------------------------------------------------------------------------
+// VocabularyRegistry
+//------------------------------------------------------------------------------
+bool VocabularyRegistry::add(const char* spec, string& error) {
+    const char* eq = strchr(spec, '=');
+    if (!eq || eq == spec || !eq[1]) {
+        error = string("expected <name>=<file>, got ") + spec;
+        return false;
+    }
+
+    shared_ptr<const CompiledVocabulary> vocab =
+        CompiledVocabulary::load(eq + 1, error);
+    if (!vocab) {
+        return false;
+    }
+
+    byName[string(spec, eq - spec)] = vocab;
+    return true;
+}
+
+shared_ptr<const CompiledVocabulary> VocabularyRegistry::find(
+    const string& name) const {
+
+    auto it = byName.find(name);
+    return it == byName.end() ? nullptr : it->second;
+}
+
+//------------------------------------------------------------------------------
+// - the tenant's words first, then the built-in rules if allowed
+//------------------------------------------------------------------------------
+Command classifyWithVocabulary(const CompiledVocabulary* vocab,
+    const char* str, size_t len) {
+
+    Command cmd;
+    if (vocab && vocab->lookup(str, len, cmd)) {
+        return cmd;
+    }
+
+    cmd = classifyLine(str, len);
+    if (vocab && !vocab->fallback() && isAccepted(cmd)) {
+        return CMD_UNRECOGNIZED;
+    }
+    return cmd;
+}
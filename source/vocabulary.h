@@ -0,0 +1,88 @@
+//----------------------------------------------------------------------
+// vocabulary.h
+//
+// Per-tenant command vocabularies for server mode.
+//
+// A vocabulary file has one "<word> <command>" pair per line, where
+// <command> is play, pause, rewind, fast-forward, stop or quit, e.g.
+//
+//     abspielen play
+//     w play
+//     fallback off
+//
+// "fallback off" turns off the built-in rules for that vocabulary, so
+// only its own words are accepted. Lines starting with '#' are
+// comments. Words are matched exactly, ignoring ASCII case.
+//
+// A loaded vocabulary is compiled once into an immutable hash table
+// and shared by every connection bound to it through a shared_ptr, so
+// another tenant costs only its own table and every lookup is the
+// same single probe sequence.
+//----------------------------------------------------------------------
+#pragma once
+
+#include "cmd_validate.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------
+// CompiledVocabulary : open-addressing table over one string arena
+//----------------------------------------------------------------------
+class CompiledVocabulary {
+public:
+    // - reads and compiles a vocabulary file
+    // - returns nullptr and sets error on failure
+    static std::shared_ptr<const CompiledVocabulary> load(const char* path,
+        std::string& error);
+
+    // - finds a word, ignoring ASCII case
+    bool lookup(const char* str, size_t len, Command& cmd) const;
+
+    // true unless the file said "fallback off"
+    bool fallback() const { return useFallback; }
+
+    size_t words() const { return wordCount; }
+    size_t memoryBytes() const;
+
+private:
+    struct Slot {
+        uint32_t offset;                // into arena
+        uint16_t len;                   // 0 = empty slot
+        uint8_t cmd;
+    };
+
+    std::vector<Slot> slots;            // power-of-two size
+    std::string arena;                  // folded words, back to back
+    size_t wordCount = 0;
+    bool useFallback = true;
+
+    bool insert(const std::string& folded, Command cmd);
+};
+
+//----------------------------------------------------------------------
+// VocabularyRegistry : vocabularies by tenant name
+//----------------------------------------------------------------------
+class VocabularyRegistry {
+public:
+    // - loads "<name>=<file>", returns false and sets error on failure
+    bool add(const char* spec, std::string& error);
+
+    // nullptr if there is no vocabulary by that name
+    std::shared_ptr<const CompiledVocabulary> find(
+        const std::string& name) const;
+
+private:
+    std::map<std::string, std::shared_ptr<const CompiledVocabulary>> byName;
+};
+
+//----------------------------------------------------------------------
+// - classifies a line for a connection bound to vocab, or with the
+//   built-in rules when vocab is null
+//----------------------------------------------------------------------
+Command classifyWithVocabulary(const CompiledVocabulary* vocab,
+    const char* str, size_t len);
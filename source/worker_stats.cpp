@@ -0,0 +1,113 @@
+//----------------------------------------------------------------------
+// worker_stats.cpp
+//
+// The shared stats segment. On POSIX it is an anonymous MAP_SHARED
+// mapping, which fork() leaves shared between the master and its
+// workers. Windows has no fork(), so there it is plain heap memory.
+//----------------------------------------------------------------------
+#include "worker_stats.h"
+
+#include <new>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+//------------------------------------------------------------------------------
+// WorkerCounters
+//------------------------------------------------------------------------------
+void WorkerCounters::merge(const WorkerCounters& other) {
+    admission.admitted += other.admission.admitted;
+    admission.shed += other.admission.shed;
+    admission.deferred += other.admission.deferred;
+    for (int i = 0; i <= CMD_NUM_COMMANDS; ++i) {
+        stale.byCommand[i] += other.stale.byCommand[i];
+    }
+    stale.total += other.stale.total;
+    expiredSessions += other.expiredSessions;
+}
+
+//------------------------------------------------------------------------------
+// StatsSegment
+//------------------------------------------------------------------------------
+StatsSegment::StatsSegment(size_t workers) : count(workers) {
+    size_t bytes = (count + 1) * sizeof(Slot);
+#ifndef _WIN32
+    void* map = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        return;
+    }
+#else
+    void* map = ::operator new(bytes, std::align_val_t(alignof(Slot)));
+#endif
+
+    // fresh pages are zero, but start the atomics' lifetimes properly
+    slots = static_cast<Slot*>(map);
+    for (size_t i = 0; i <= count; ++i) {
+        new (&slots[i]) Slot{};
+    }
+}
+
+StatsSegment::~StatsSegment() {
+    if (!slots) {
+        return;
+    }
+#ifndef _WIN32
+    munmap(slots, (count + 1) * sizeof(Slot));
+#else
+    ::operator delete(slots, std::align_val_t(alignof(Slot)));
+#endif
+}
+
+void StatsSegment::publish(size_t worker, const WorkerCounters& counters) {
+    store(slots[worker], counters);
+}
+
+void StatsSegment::retire(size_t worker) {
+    WorkerCounters retired = load(slots[count]);
+    retired.merge(load(slots[worker]));
+    store(slots[count], retired);
+    store(slots[worker], WorkerCounters{});
+}
+
+WorkerCounters StatsSegment::sum() const {
+    WorkerCounters total;
+    for (size_t i = 0; i <= count; ++i) {
+        total.merge(load(slots[i]));
+    }
+    return total;
+}
+
+//------------------------------------------------------------------------------
+// - the slot layout: admission, stale by opcode, stale total, expired
+//------------------------------------------------------------------------------
+void StatsSegment::store(Slot& slot, const WorkerCounters& c) {
+    std::atomic<uint64_t>* v = slot.values;
+    v[0].store(c.admission.admitted, std::memory_order_relaxed);
+    v[1].store(c.admission.shed, std::memory_order_relaxed);
+    v[2].store(c.admission.deferred, std::memory_order_relaxed);
+    v += 3;
+    for (int i = 0; i <= CMD_NUM_COMMANDS; ++i) {
+        v[i].store(c.stale.byCommand[i], std::memory_order_relaxed);
+    }
+    v += CMD_NUM_COMMANDS + 1;
+    v[0].store(c.stale.total, std::memory_order_relaxed);
+    v[1].store(c.expiredSessions, std::memory_order_relaxed);
+}
+
+WorkerCounters StatsSegment::load(const Slot& slot) {
+    WorkerCounters c;
+    const std::atomic<uint64_t>* v = slot.values;
+    c.admission.admitted = v[0].load(std::memory_order_relaxed);
+    c.admission.shed = v[1].load(std::memory_order_relaxed);
+    c.admission.deferred = v[2].load(std::memory_order_relaxed);
+    v += 3;
+    for (int i = 0; i <= CMD_NUM_COMMANDS; ++i) {
+        c.stale.byCommand[i] = v[i].load(std::memory_order_relaxed);
+    }
+    v += CMD_NUM_COMMANDS + 1;
+    c.stale.total = v[0].load(std::memory_order_relaxed);
+    c.expiredSessions = v[1].load(std::memory_order_relaxed);
+    return c;
+}
@@ -0,0 +1,79 @@
+//----------------------------------------------------------------------
+// worker_stats.h
+//
+// Counters of prefork server workers, kept in one shared memory
+// segment so any process can add them up without asking the others.
+//
+// Each worker owns one cache-line aligned slot and is its only writer:
+// it stores its running totals with relaxed atomic stores, and readers
+// load them the same way. No counter is ever written by two processes,
+// so there are no locks and no read-modify-write across processes.
+//
+// A slot holds running totals, not deltas. When a worker dies, the
+// master folds its slot into a retired slot that only the master
+// writes, then clears the slot for the replacement worker.
+//----------------------------------------------------------------------
+#pragma once
+
+#include "staleness.h"
+#include "token_bucket.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//----------------------------------------------------------------------
+// WorkerCounters : what one server process has counted
+//----------------------------------------------------------------------
+struct WorkerCounters {
+    AdmissionCounters admission;
+    StaleCounters stale;
+    uint64_t expiredSessions = 0;
+
+    void merge(const WorkerCounters& other);
+};
+
+//----------------------------------------------------------------------
+// StatsSegment : one slot per worker plus the retired slot, mapped
+// MAP_SHARED before fork() so every worker sees the same pages
+//----------------------------------------------------------------------
+class StatsSegment {
+public:
+    explicit StatsSegment(size_t workers);
+    ~StatsSegment();
+
+    StatsSegment(const StatsSegment&) = delete;
+    StatsSegment& operator=(const StatsSegment&) = delete;
+
+    // false if the segment could not be mapped
+    bool ok() const { return slots != nullptr; }
+    size_t workers() const { return count; }
+
+    // - stores a worker's totals, only ever called by that worker
+    void publish(size_t worker, const WorkerCounters& counters);
+
+    // - adds a dead worker's slot to the retired slot and clears it
+    // - master only, after the worker has been reaped
+    void retire(size_t worker);
+
+    // - totals over all workers, live and retired
+    // - lock-free; a retire() running at the same time may be seen
+    //   half done, which only skews that one reading
+    WorkerCounters sum() const;
+
+private:
+    // admission, stale by opcode, stale total, expired sessions
+    static constexpr size_t VALUES = 3 + (CMD_NUM_COMMANDS + 1) + 1 + 1;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> values[VALUES];
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free,
+        "counters in shared memory must not need a lock");
+
+    Slot* slots = nullptr;          // count worker slots, then retired
+    size_t count;
+
+    static void store(Slot& slot, const WorkerCounters& counters);
+    static WorkerCounters load(const Slot& slot);
+};
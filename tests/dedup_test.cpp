@@ -0,0 +1,113 @@
+//----------------------------------------------------------------------
+// dedup_test.cpp
+//
+// Randomized check of DedupTable against a std::map reference that
+// remembers every (session, seq) it was given and the result stored
+// for it.
+//
+// Sequence numbers mostly step forward, with retries and reordering
+// inside and below the window; sessions are forgotten now and then.
+// Every check() must agree with the reference: FIRST for a new pair
+// in the window, DUPLICATE with the stored result for a repeat, and
+// TOO_OLD for anything that fell below the window. The table is sized
+// so nothing is evicted, which the reference could not follow.
+//
+// Build and run from the repository root:
+//
+//     g++ -std=c++20 -O2 -Isource tests/dedup_test.cpp source/dedup.cpp
+//         -o dedup_test
+//     ./dedup_test
+//----------------------------------------------------------------------
+#include "dedup.h"
+
+#include <cstdio>
+#include <map>
+#include <random>
+#include <utility>
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::map;
+using std::pair;
+
+namespace {
+
+constexpr uint64_t SESSIONS = 5000;
+constexpr int STEPS = 2000000;
+
+} // namespace
+
+int main() {
+    std::mt19937_64 random(7);
+    DedupTable table(1 << 20);
+
+    map<pair<uint64_t, uint64_t>, Command> results;
+    map<uint64_t, uint64_t> maxSeq;
+
+    for (int step = 0; step < STEPS; ++step) {
+        uint64_t session = random() % SESSIONS;
+
+        // now and then a session ends and starts over
+        if (random() % 1000 == 0) {
+            table.forget(session);
+            results.erase(results.lower_bound({ session, 0 }),
+                results.lower_bound({ session + 1, 0 }));
+            maxSeq.erase(session);
+            continue;
+        }
+
+        // a quarter step ahead, the rest retry somewhere behind
+        auto known = maxSeq.find(session);
+        uint64_t top = known != maxSeq.end() ? known->second : 0;
+        uint64_t back = random() % 80;
+        uint64_t seq = random() % 4 == 0 ? top + random() % 5
+            : top > back ? top - back : random() % 3;
+        Command result =
+            static_cast<Command>(random() % (CMD_UNRECOGNIZED + 1));
+
+        Command stored;
+        DedupTable::Verdict verdict = table.check(session, seq, stored);
+
+        uint64_t high = seq > top ? seq : top;
+        if (known != maxSeq.end() && high - seq >= DedupTable::WINDOW) {
+            if (verdict != DedupTable::TOO_OLD) {
+                printf("step %d: session %llu seq %llu should be too old\n",
+                    step, (unsigned long long)session,
+                    (unsigned long long)seq);
+                return 1;
+            }
+            continue;
+        }
+
+        auto seen = results.find({ session, seq });
+        if (seen != results.end()) {
+            if (verdict != DedupTable::DUPLICATE || stored != seen->second) {
+                printf("step %d: session %llu seq %llu should be a"
+                    " duplicate of %d\n", step, (unsigned long long)session,
+                    (unsigned long long)seq, seen->second);
+                return 1;
+            }
+        }
+        else {
+            if (verdict != DedupTable::FIRST) {
+                printf("step %d: session %llu seq %llu should be first\n",
+                    step, (unsigned long long)session,
+                    (unsigned long long)seq);
+                return 1;
+            }
+            table.store(result);
+            results[{ session, seq }] = result;
+        }
+        maxSeq[session] = high;
+    }
+
+    if (table.evictions()) {
+        printf("%llu evictions, the reference cannot follow those\n",
+            (unsigned long long)table.evictions());
+        return 1;
+    }
+
+    printf("ok: %zu results stored and checked\n", results.size());
+    return 0;
+}
@@ -0,0 +1,154 @@
+//----------------------------------------------------------------------
+// line_index_test.cpp
+//
+// Randomized checks of the newline index.
+//
+// LineIndex::build() against a byte-at-a-time scan: random blocks of
+// every length up to a few SSE2 steps, starting at every alignment,
+// with newlines from dense to absent and bytes that differ from '\n'
+// only in one bit. The offsets must match exactly.
+//
+// BlockLineReader against LineReader on the same random input, with a
+// small line limit so that too-long lines, also ones spanning blocks,
+// and a last line without a newline all come up.
+//
+// Build and run from the repository root:
+//
+//     g++ -std=c++20 -O2 -Isource tests/line_index_test.cpp
+//         source/line_index.cpp source/line_reader.cpp -o line_index_test
+//     ./line_index_test
+//----------------------------------------------------------------------
+#include "line_index.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::string;
+using std::vector;
+
+namespace {
+
+constexpr int BLOCKS = 200000;
+constexpr size_t MAX_BLOCK = 200;
+constexpr size_t STREAM_BYTES = 4 * INDEX_WINDOW;
+constexpr size_t STREAM_MAX_LINE = 64;
+
+// '\n' and its one-bit neighbours, '\r', and high-bit bytes
+const char NEAR_NEWLINE[] = { '\x0b', '\x08', '\x0e', '\x1a', '\x2a',
+    '\x4a', '\x8a', '\r', '\xff', '\x80' };
+
+//----------------------------------------------------------------------
+// - random bytes with about one newline in `spacing`, 0 for none
+//----------------------------------------------------------------------
+void fill(std::mt19937_64& random, char* data, size_t len, unsigned spacing) {
+    for (size_t i = 0; i < len; ++i) {
+        if (spacing && random() % spacing == 0) {
+            data[i] = '\n';
+        }
+        else if (random() % 4 == 0) {
+            data[i] = NEAR_NEWLINE[random() % sizeof NEAR_NEWLINE];
+        }
+        else {
+            data[i] = static_cast<char>('a' + random() % 26);
+        }
+    }
+}
+
+bool checkBlocks(std::mt19937_64& random) {
+    const unsigned spacings[] = { 0, 1, 2, 8, 33, 200 };
+    vector<char> buf(MAX_BLOCK + 32);
+    vector<uint32_t> expected;
+    LineIndex index;
+
+    for (int block = 0; block < BLOCKS; ++block) {
+        size_t shift = random() % 32;
+        size_t len = random() % MAX_BLOCK;
+        unsigned spacing = spacings[random() % std::size(spacings)];
+        char* data = buf.data() + shift;
+        fill(random, data, len, spacing);
+
+        expected.clear();
+        for (size_t i = 0; i < len; ++i) {
+            if (data[i] == '\n') {
+                expected.push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        index.build(data, len);
+        if (index.size() != expected.size()
+            || !std::equal(index.begin(), index.end(), expected.begin())) {
+            printf("block %d (len %zu at +%zu): %zu offsets, expected %zu\n",
+                block, len, shift, index.size(), expected.size());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool checkStream(std::mt19937_64& random) {
+    // lines of every length around the limit, now and then a very
+    // long one, and no newline at the end
+    string input;
+    while (input.size() < STREAM_BYTES) {
+        size_t len = random() % 500 == 0 ? random() % (3 * INDEX_WINDOW / 2)
+            : random() % (2 * STREAM_MAX_LINE);
+        size_t at = input.size();
+        input.resize(at + len);
+        fill(random, &input[at], len, 0);
+        input += '\n';
+    }
+    input += "last";
+
+    FILE* file = tmpfile();
+    if (!file || fwrite(input.data(), 1, input.size(), file) != input.size()) {
+        printf("cannot write the temporary file\n");
+        return false;
+    }
+    rewind(file);
+
+    std::istringstream in(input);
+    LineReader reference(in, STREAM_MAX_LINE);
+    BlockLineReader reader(file, STREAM_MAX_LINE);
+
+    string want;
+    char* line;
+    size_t len;
+    for (size_t n = 0;; ++n) {
+        LineReader::Result expected = reference.next(want);
+        LineReader::Result got = reader.next(line, len);
+        if (got != expected || (got != LineReader::END
+            && string(line, len) != want)) {
+            printf("line %zu: result %d, expected %d\n", n, got, expected);
+            fclose(file);
+            return false;
+        }
+        if (got == LineReader::END) {
+            printf("ok: %zu lines read in blocks\n", n);
+            break;
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937_64 random(11);
+
+    if (!checkBlocks(random)) {
+        return 1;
+    }
+    printf("ok: %d blocks indexed\n", BLOCKS);
+
+    return checkStream(random) ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+//----------------------------------------------------------------------
+// normalize_test.cpp
+//
+// Randomized check of normalizeLine() and trimLine() against a plain
+// byte-at-a-time reference that builds the expected line in a string.
+//
+// Lines mix words with runs of ' ', '\t' and '\r' of every length, at
+// both ends and inside, and start at every alignment, so the SSE2 scan
+// in plainRun() sees blanks in every lane and runs that cross its
+// 16-byte steps. Bytes that are not blanks but close to them ('\v',
+// '\f', '\n', high-bit bytes) must be kept as they are.
+//
+// Build and run from the repository root:
+//
+//     g++ -std=c++20 -O2 -Isource tests/normalize_test.cpp
+//         source/normalize.cpp -o normalize_test
+//     ./normalize_test
+//----------------------------------------------------------------------
+#include "normalize.h"
+
+#include <cstdio>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::string;
+using std::vector;
+
+namespace {
+
+constexpr int LINES = 1000000;
+constexpr size_t MAX_LINE = 120;
+
+const char BLANKS[] = { ' ', '\t', '\r' };
+const char NEAR_BLANKS[] = { '\v', '\f', '\n', '!', '\xa0', '\x89', '\x8d' };
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+//----------------------------------------------------------------------
+// - the reference: trim both ends, one space for each inner run
+//----------------------------------------------------------------------
+string normalized(const string& line) {
+    string out;
+    bool pendingSpace = false;
+    for (char c : line) {
+        if (isBlank(c)) {
+            pendingSpace = !out.empty();
+            continue;
+        }
+        if (pendingSpace) {
+            out += ' ';
+            pendingSpace = false;
+        }
+        out += c;
+    }
+    return out;
+}
+
+string trimmed(const string& line) {
+    size_t first = 0, last = line.size();
+    while (first < last && isBlank(line[first])) {
+        ++first;
+    }
+    while (last > first && isBlank(line[last - 1])) {
+        --last;
+    }
+    return line.substr(first, last - first);
+}
+
+//----------------------------------------------------------------------
+// - words and blank runs, with long runs now and then
+//----------------------------------------------------------------------
+string randomLine(std::mt19937_64& random) {
+    string line;
+    size_t len = random() % MAX_LINE;
+    while (line.size() < len) {
+        size_t run = random() % 8 == 0 ? random() % 40 : 1 + random() % 6;
+        bool blank = random() % 2 == 0;
+        for (size_t i = 0; i < run; ++i) {
+            if (blank) {
+                line += BLANKS[random() % std::size(BLANKS)];
+            }
+            else if (random() % 10 == 0) {
+                line += NEAR_BLANKS[random() % std::size(NEAR_BLANKS)];
+            }
+            else {
+                line += static_cast<char>('a' + random() % 26);
+            }
+        }
+    }
+    return line;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937_64 random(5);
+    vector<char> buf(MAX_LINE + 64);
+    size_t changed = 0;
+
+    for (int n = 0; n < LINES; ++n) {
+        string line = randomLine(random);
+        size_t shift = random() % 16;
+        char* data = buf.data() + shift;
+        line.copy(data, line.size());
+
+        const char* view = data;
+        size_t viewLen = line.size();
+        trimLine(view, viewLen);
+        if (string(view, viewLen) != trimmed(line)) {
+            printf("line %d: trimLine() differs on \"%s\"\n", n, line.c_str());
+            return 1;
+        }
+
+        string expected = normalized(line);
+        size_t len = normalizeLine(data, line.size());
+        if (string(data, len) != expected) {
+            printf("line %d: \"%s\" became \"%s\", expected \"%s\"\n", n,
+                line.c_str(), string(data, len).c_str(), expected.c_str());
+            return 1;
+        }
+        changed += expected != line;
+    }
+
+    printf("ok: %d lines normalized, %zu of them changed\n", LINES, changed);
+    return 0;
+}
@@ -0,0 +1,111 @@
+//----------------------------------------------------------------------
+// timer_wheel_test.cpp
+//
+// Randomized check of TimerWheel against a brute-force reference: a
+// plain array of due ticks that is scanned after every advance().
+//
+// Random schedules (near and far, including past the top level),
+// reschedules, cancels and clock jumps are applied to both. Every
+// timer must fire exactly once, not before its tick and not after the
+// advance() that passes it, and size() must match the reference.
+//
+// Build and run from the repository root:
+//
+//     g++ -std=c++20 -O2 -Isource tests/timer_wheel_test.cpp
+//         source/timer_wheel.cpp -o timer_wheel_test
+//     ./timer_wheel_test
+//----------------------------------------------------------------------
+#include "timer_wheel.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+//----------------------------------------------------------------------
+// using symbols
+//----------------------------------------------------------------------
+using std::vector;
+
+namespace {
+
+constexpr size_t TIMERS = 5000;
+constexpr int STEPS = 200000;
+constexpr uint64_t START = 1000;
+
+} // namespace
+
+int main() {
+    std::mt19937_64 random(3);
+    TimerWheel wheel(START);
+
+    vector<TimerNode> nodes(TIMERS);
+    vector<uint64_t> due(TIMERS, 0);
+    vector<bool> pending(TIMERS, false);
+    size_t pendingCount = 0;
+    uint64_t now = START;
+    uint64_t fired = 0;
+
+    for (int step = 0; step < STEPS; ++step) {
+        unsigned op = random() % 10;
+        size_t i = random() % TIMERS;
+
+        if (op < 5) {
+            // mostly near timers, some far past the top level
+            uint64_t delay = random() % 4 == 0
+                ? random() % 20000000 : random() % 5000;
+            nodes[i].key = i;
+            wheel.schedule(nodes[i], now + delay);
+
+            // a tick already reached fires on the next advance
+            due[i] = delay ? now + delay : now + 1;
+            pendingCount += !pending[i];
+            pending[i] = true;
+        }
+        else if (op < 6) {
+            wheel.cancel(nodes[i]);
+            pendingCount -= pending[i];
+            pending[i] = false;
+        }
+        else {
+            uint64_t to = now
+                + (random() % 3 == 0 ? random() % 100000 : random() % 50);
+
+            bool early = false;
+            wheel.advance(to, [&](TimerNode& node) {
+                size_t k = node.key;
+                if (!pending[k] || due[k] > wheel.now()) {
+                    printf("timer %zu fired at %llu, due %llu%s\n", k,
+                        (unsigned long long)wheel.now(),
+                        (unsigned long long)due[k],
+                        pending[k] ? "" : " (not scheduled)");
+                    early = true;
+                }
+                pendingCount -= pending[k];
+                pending[k] = false;
+                ++fired;
+            });
+            if (early) {
+                return 1;
+            }
+
+            for (size_t k = 0; k < TIMERS; ++k) {
+                if (pending[k] && due[k] <= to) {
+                    printf("timer %zu due %llu missed by advance to %llu\n",
+                        k, (unsigned long long)due[k],
+                        (unsigned long long)to);
+                    return 1;
+                }
+            }
+            now = to;
+        }
+
+        if (pendingCount != wheel.size()) {
+            printf("size %zu, expected %zu at step %d\n", wheel.size(),
+                pendingCount, step);
+            return 1;
+        }
+    }
+
+    printf("ok: %llu timers fired\n", (unsigned long long)fired);
+    return 0;
+}